@@ -0,0 +1,279 @@
+/**
+ * TouchControllers.h
+ * Optional I2C drivers for controllers that measure their contacts -
+ * FT5x06/FT6x36 and GT911 - filling TouchPoints with the real area, weight
+ * and controller flags from one burst read per report
+ *
+ * Author: Assistant
+ * License: MIT
+ */
+
+#ifndef TOUCH_CONTROLLERS_H
+#define TOUCH_CONTROLLERS_H
+
+#include <Wire.h>
+#include "WaterRejectionTouch.h"
+
+// Returned by read() when the controller has no new report or the bus failed
+#define TOUCH_NO_REPORT 0xFF
+
+// Bytes the Wire library receives in one requestFrom() - reports that do not
+// fit are cut to the contacts that do
+#if defined(I2C_BUFFER_LENGTH)
+  #define TOUCH_WIRE_BUFFER I2C_BUFFER_LENGTH
+#elif defined(BUFFER_LENGTH)
+  #define TOUCH_WIRE_BUFFER BUFFER_LENGTH
+#else
+  #define TOUCH_WIRE_BUFFER 32
+#endif
+
+// Register access shared by the drivers
+class TouchControllerBus {
+protected:
+    TwoWire* wire;
+    uint8_t address;
+    uint8_t areaScale;                   // TouchPoint::area = raw contact size * areaScale
+    uint32_t busErrors;
+
+    explicit TouchControllerBus(uint8_t defaultAreaScale);
+
+    bool attach(TwoWire& bus, uint8_t i2cAddress);
+    // regBytes is 1 for 8-bit register addresses, 2 for 16-bit big-endian ones
+    bool readRegisters(uint16_t reg, uint8_t regBytes, uint8_t* buffer, uint8_t length);
+    bool writeRegister(uint16_t reg, uint8_t regBytes, uint8_t value);
+
+public:
+    // Scale from the controller's size units to TouchPoint::area, so the
+    // filter's maxTouchArea applies. Tune it with the area histogram of
+    // getStatsSnapshot() (WATER_REJECTION_HISTOGRAMS) on a dry panel.
+    void setAreaScale(uint8_t scale);
+    uint8_t getAreaScale() const;
+
+    // Failed transactions since begin()
+    uint32_t getBusErrors() const;
+};
+
+// FocalTech FT5x06/FT6x36 (FT6206, FT6236, FT5316...). One read of
+// TD_STATUS and all touch records per report; area comes from P_MISC and
+// pressure from P_WEIGHT. These chips do not report water per contact, so
+// points carry TOUCH_FLAG_HW_AREA only.
+template <uint8_t MaxPoints>
+class FocalTechTouchT : public TouchControllerBus {
+private:
+    static const uint8_t REG_TD_STATUS = 0x02;   // Followed by the touch records
+    static const uint8_t RECORD_SIZE = 6;
+    static const uint8_t BURST_RECORDS = MaxPoints < (TOUCH_WIRE_BUFFER - 1) / RECORD_SIZE
+        ? MaxPoints : (TOUCH_WIRE_BUFFER - 1) / RECORD_SIZE;
+    static const uint8_t EVENT_LIFT_UP = 1;
+
+public:
+    static const uint8_t DEFAULT_ADDRESS = 0x38;
+
+    FocalTechTouchT();
+
+    // Returns false if nothing acknowledges at address
+    bool begin(TwoWire& bus = Wire, uint8_t i2cAddress = DEFAULT_ADDRESS);
+
+    // Fill up to maxPoints touches, all stamped with one waterRejectionNow().
+    // Returns the contact count (0 when released, ready for processMultiTouch())
+    // or TOUCH_NO_REPORT on a bus error.
+    uint8_t read(TouchPoint* points, uint8_t maxPoints);
+};
+
+// Goodix GT911. One read of the status byte and all point records per
+// report, then the status is cleared so the chip can post the next one.
+// Its large-area detect, raised for palms and films of water, sets
+// TOUCH_FLAG_HW_WATER on every contact of the report.
+template <uint8_t MaxPoints>
+class GT911TouchT : public TouchControllerBus {
+private:
+    static const uint16_t REG_STATUS = 0x814E;   // Followed by the point records
+    static const uint8_t RECORD_SIZE = 8;
+    static const uint8_t BURST_RECORDS = MaxPoints < (TOUCH_WIRE_BUFFER - 1) / RECORD_SIZE
+        ? MaxPoints : (TOUCH_WIRE_BUFFER - 1) / RECORD_SIZE;
+    static const uint8_t STATUS_READY = 0x80;
+    static const uint8_t STATUS_LARGE = 0x40;
+    static const uint8_t STATUS_COUNT = 0x0F;
+
+public:
+    static const uint8_t DEFAULT_ADDRESS = 0x5D;     // 0x14 with INT high at reset
+
+    GT911TouchT();
+
+    bool begin(TwoWire& bus = Wire, uint8_t i2cAddress = DEFAULT_ADDRESS);
+
+    // As FocalTechTouchT::read(); also returns TOUCH_NO_REPORT while the
+    // chip has not posted a new report since the last read
+    uint8_t read(TouchPoint* points, uint8_t maxPoints);
+};
+
+typedef FocalTechTouchT<2> FT6x36Touch;
+typedef FocalTechTouchT<5> FT5x06Touch;
+typedef GT911TouchT<5> GT911Touch;
+
+// TouchControllerBus implementation
+inline TouchControllerBus::TouchControllerBus(uint8_t defaultAreaScale)
+    : wire(nullptr), address(0), areaScale(defaultAreaScale), busErrors(0) {
+}
+
+inline bool TouchControllerBus::attach(TwoWire& bus, uint8_t i2cAddress) {
+    wire = &bus;
+    address = i2cAddress;
+    busErrors = 0;
+
+    wire->beginTransmission(address);
+    return wire->endTransmission() == 0;
+}
+
+inline bool TouchControllerBus::readRegisters(uint16_t reg, uint8_t regBytes, uint8_t* buffer,
+                                              uint8_t length) {
+    if (!wire) {
+        return false;
+    }
+
+    wire->beginTransmission(address);
+    if (regBytes == 2) {
+        wire->write((uint8_t)(reg >> 8));
+    }
+    wire->write((uint8_t)reg);
+
+    // Repeated start, then the whole block in one transfer
+    if (wire->endTransmission(false) != 0 ||
+        wire->requestFrom(address, length) != length) {
+        busErrors++;
+        return false;
+    }
+    for (uint8_t i = 0; i < length; i++) {
+        buffer[i] = wire->read();
+    }
+    return true;
+}
+
+inline bool TouchControllerBus::writeRegister(uint16_t reg, uint8_t regBytes, uint8_t value) {
+    if (!wire) {
+        return false;
+    }
+
+    wire->beginTransmission(address);
+    if (regBytes == 2) {
+        wire->write((uint8_t)(reg >> 8));
+    }
+    wire->write((uint8_t)reg);
+    wire->write(value);
+    if (wire->endTransmission() != 0) {
+        busErrors++;
+        return false;
+    }
+    return true;
+}
+
+inline void TouchControllerBus::setAreaScale(uint8_t scale) {
+    areaScale = scale;
+}
+
+inline uint8_t TouchControllerBus::getAreaScale() const {
+    return areaScale;
+}
+
+inline uint32_t TouchControllerBus::getBusErrors() const {
+    return busErrors;
+}
+
+// FocalTechTouchT implementation
+template <uint8_t MaxPoints>
+FocalTechTouchT<MaxPoints>::FocalTechTouchT()
+    : TouchControllerBus(4) {            // P_MISC area is 4 bits - 0..60 after scaling
+}
+
+template <uint8_t MaxPoints>
+bool FocalTechTouchT<MaxPoints>::begin(TwoWire& bus, uint8_t i2cAddress) {
+    return attach(bus, i2cAddress);
+}
+
+template <uint8_t MaxPoints>
+uint8_t FocalTechTouchT<MaxPoints>::read(TouchPoint* points, uint8_t maxPoints) {
+    uint8_t buffer[1 + BURST_RECORDS * RECORD_SIZE];
+    if (!readRegisters(REG_TD_STATUS, 1, buffer, sizeof(buffer))) {
+        return TOUCH_NO_REPORT;
+    }
+
+    // Counts above the chip's maximum are what it reports between touches
+    uint8_t reported = buffer[0] & 0x0F;
+    if (reported > MaxPoints) {
+        reported = 0;
+    }
+    if (reported > BURST_RECORDS) {
+        reported = BURST_RECORDS;
+    }
+
+    uint32_t now = waterRejectionNow();
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < reported && count < maxPoints; i++) {
+        const uint8_t* record = buffer + 1 + i * RECORD_SIZE;
+        if ((record[0] >> 6) == EVENT_LIFT_UP) {
+            continue;
+        }
+
+        TouchPoint& point = points[count++];
+        point.x = ((int16_t)(record[0] & 0x0F) << 8) | record[1];
+        point.y = ((int16_t)(record[2] & 0x0F) << 8) | record[3];
+        point.timestamp = now;
+        point.pressure = record[4];
+        point.area = (uint16_t)(record[5] >> 4) * areaScale;
+        point.flags = TOUCH_FLAG_HW_AREA;
+        point.valid = true;
+        point.id = 0;
+    }
+    return count;
+}
+
+// GT911TouchT implementation
+template <uint8_t MaxPoints>
+GT911TouchT<MaxPoints>::GT911TouchT()
+    : TouchControllerBus(1) {            // Point size is already in area-like units
+}
+
+template <uint8_t MaxPoints>
+bool GT911TouchT<MaxPoints>::begin(TwoWire& bus, uint8_t i2cAddress) {
+    return attach(bus, i2cAddress);
+}
+
+template <uint8_t MaxPoints>
+uint8_t GT911TouchT<MaxPoints>::read(TouchPoint* points, uint8_t maxPoints) {
+    uint8_t buffer[1 + BURST_RECORDS * RECORD_SIZE];
+    if (!readRegisters(REG_STATUS, 2, buffer, sizeof(buffer))) {
+        return TOUCH_NO_REPORT;
+    }
+
+    uint8_t status = buffer[0];
+    if (!(status & STATUS_READY)) {
+        return TOUCH_NO_REPORT;
+    }
+    writeRegister(REG_STATUS, 2, 0);     // Hand the buffer back to the chip
+
+    uint8_t reported = status & STATUS_COUNT;
+    if (reported > BURST_RECORDS) {
+        reported = BURST_RECORDS;
+    }
+    uint8_t flags = TOUCH_FLAG_HW_AREA | ((status & STATUS_LARGE) ? TOUCH_FLAG_HW_WATER : 0);
+
+    uint32_t now = waterRejectionNow();
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < reported && count < maxPoints; i++) {
+        const uint8_t* record = buffer + 1 + i * RECORD_SIZE;
+        uint16_t size = record[5] | ((uint16_t)record[6] << 8);
+
+        TouchPoint& point = points[count++];
+        point.x = record[1] | ((int16_t)record[2] << 8);
+        point.y = record[3] | ((int16_t)record[4] << 8);
+        point.timestamp = now;
+        point.pressure = size > 255 ? 255 : size;    // No separate weight on the GT911
+        point.area = size * areaScale;
+        point.flags = flags;
+        point.valid = true;
+        point.id = 0;
+    }
+    return count;
+}
+
+#endif // TOUCH_CONTROLLERS_H
\ No newline at end of file
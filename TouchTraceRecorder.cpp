@@ -0,0 +1,162 @@
+/**
+ * TouchTraceRecorder.cpp
+ * Delta-encoded block ring for recording touches in the field
+ *
+ * Author: Assistant
+ * License: MIT
+ */
+
+#include "TouchTraceRecorder.h"
+
+TouchTraceRecorder::TouchTraceRecorder()
+    : storage(nullptr), blockCount(0), screenWidth(0), screenHeight(0),
+      openBlock(0), openLength(0), oldestBlock(0), completedBlocks(0), nextSequence(0),
+      lastX(0), lastY(0), lastTime(0), recordedSamples(0), droppedBlocks(0) {
+}
+
+bool TouchTraceRecorder::begin(uint8_t* buffer, size_t size, uint16_t width, uint16_t height) {
+    size_t blocks = size / BLOCK_SIZE;
+    if (!buffer || blocks < 2) {
+        return false;
+    }
+
+    storage = buffer;
+    blockCount = blocks > 0xFFFF ? 0xFFFF : blocks;
+    screenWidth = width;
+    screenHeight = height;
+    clear();
+    return true;
+}
+
+void TouchTraceRecorder::clear() {
+    openBlock = 0;
+    openLength = 0;         // Opened lazily by the first record
+    oldestBlock = 0;
+    completedBlocks = 0;
+    nextSequence = 0;
+    recordedSamples = 0;
+    droppedBlocks = 0;
+}
+
+uint8_t* TouchTraceRecorder::blockAt(uint16_t block) const {
+    return storage + (size_t)block * BLOCK_SIZE;
+}
+
+void TouchTraceRecorder::startBlock(uint32_t startTime) {
+    uint32_t baseTime = startTime / WATER_REJECTION_TICKS_PER_MS;
+    uint8_t* block = blockAt(openBlock);
+    block[0] = TRACE_BLOCK_MAGIC;
+    block[1] = TRACE_FORMAT_VERSION;
+    block[4] = nextSequence;
+    block[5] = nextSequence >> 8;
+    block[6] = nextSequence >> 16;
+    block[7] = nextSequence >> 24;
+    block[8] = baseTime;
+    block[9] = baseTime >> 8;
+    block[10] = baseTime >> 16;
+    block[11] = baseTime >> 24;
+    block[12] = screenWidth;
+    block[13] = screenWidth >> 8;
+    block[14] = screenHeight;
+    block[15] = screenHeight >> 8;
+    nextSequence++;
+
+    openLength = HEADER_SIZE;
+    lastX = 0;
+    lastY = 0;
+    lastTime = startTime;
+}
+
+void TouchTraceRecorder::closeBlock() {
+    uint8_t* block = blockAt(openBlock);
+    block[2] = openLength;
+    block[3] = openLength >> 8;
+    memset(block + openLength, 0, BLOCK_SIZE - openLength);
+
+    completedBlocks++;
+    openBlock = openBlock + 1 < blockCount ? openBlock + 1 : 0;
+    openLength = 0;
+
+    // Ring full - the next block overwrites the oldest unflushed one
+    if (completedBlocks == blockCount) {
+        oldestBlock = oldestBlock + 1 < blockCount ? oldestBlock + 1 : 0;
+        completedBlocks--;
+        droppedBlocks++;
+    }
+}
+
+uint8_t TouchTraceRecorder::writeVarint(uint8_t* out, uint32_t value) {
+    uint8_t length = 0;
+    while (value >= 0x80) {
+        out[length++] = (uint8_t)value | 0x80;
+        value >>= 7;
+    }
+    out[length++] = value;
+    return length;
+}
+
+uint32_t TouchTraceRecorder::zigzag(int32_t value) {
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+void TouchTraceRecorder::record(const TouchPoint& touch, bool accepted) {
+    if (!storage) {
+        return;
+    }
+
+    if (openLength == 0) {
+        startBlock(touch.timestamp);
+    } else if (openLength > BLOCK_SIZE - MAX_RECORD_SIZE) {
+        closeBlock();
+        startBlock(touch.timestamp);
+    }
+
+    uint8_t* out = blockAt(openBlock) + openLength;
+    uint8_t length = 0;
+
+    out[length++] = (accepted ? TRACE_FLAG_ACCEPTED : 0) | (touch.valid ? TRACE_FLAG_VALID : 0);
+    length += writeVarint(out + length, zigzag((int32_t)touch.x - lastX));
+    length += writeVarint(out + length, zigzag((int32_t)touch.y - lastY));
+    uint32_t dt = (touch.timestamp - lastTime) / WATER_REJECTION_TICKS_PER_MS;
+    length += writeVarint(out + length, dt);
+    length += writeVarint(out + length, ((uint32_t)touch.area << 8) | touch.pressure);
+
+    openLength += length;
+    lastX = touch.x;
+    lastY = touch.y;
+    lastTime += dt * WATER_REJECTION_TICKS_PER_MS;  // Keep the sub-ms remainder
+    recordedSamples++;
+}
+
+void TouchTraceRecorder::finishBlock() {
+    if (storage && openLength > HEADER_SIZE) {
+        closeBlock();
+    }
+}
+
+size_t TouchTraceRecorder::flush(Print& out, size_t maxBlocks) {
+    size_t written = 0;
+
+    while (completedBlocks > 0 && written < maxBlocks) {
+        if (out.write(blockAt(oldestBlock), BLOCK_SIZE) != BLOCK_SIZE) {
+            break;  // Destination full or busy - keep the block for next time
+        }
+        oldestBlock = oldestBlock + 1 < blockCount ? oldestBlock + 1 : 0;
+        completedBlocks--;
+        written++;
+    }
+
+    return written;
+}
+
+uint16_t TouchTraceRecorder::getPendingBlocks() const {
+    return completedBlocks;
+}
+
+uint32_t TouchTraceRecorder::getRecordedCount() const {
+    return recordedSamples;
+}
+
+uint32_t TouchTraceRecorder::getDroppedBlocks() const {
+    return droppedBlocks;
+}
\ No newline at end of file
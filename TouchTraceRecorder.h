@@ -0,0 +1,99 @@
+/**
+ * TouchTraceRecorder.h
+ * Compact in-memory recorder of raw touches and filter verdicts, for
+ * collecting field data that the host replay harness can load directly
+ *
+ * Author: Assistant
+ * License: MIT
+ */
+
+#ifndef TOUCH_TRACE_RECORDER_H
+#define TOUCH_TRACE_RECORDER_H
+
+#include <Arduino.h>
+#include "WaterRejectionTouch.h"
+
+// Records are delta-encoded into fixed-size blocks held in a caller-supplied
+// ring (RAM or PSRAM). Each block is self-contained so it can be decoded on
+// its own after a lost or overwritten neighbour:
+//
+//   Block header (16 bytes, little-endian)
+//     uint8  magic          TRACE_BLOCK_MAGIC
+//     uint8  version        TRACE_FORMAT_VERSION
+//     uint16 length         Header plus record bytes used
+//     uint32 sequence       Block number since begin()
+//     uint32 baseTime       Timestamp the first record's dt is relative to
+//     uint16 screenWidth
+//     uint16 screenHeight
+//
+//   Record (5 to 16 bytes)
+//     uint8  flags          TRACE_FLAG_* bits
+//     varint zigzag(dx)     From the previous record (from 0 for the first)
+//     varint zigzag(dy)
+//     varint dt             ms from the previous record (from baseTime)
+//     varint area << 8 | pressure
+//
+// Times are in ms on either filter timebase. The remainder of a block is zero
+// filled; flush() always writes whole blocks so the output can go straight to
+// flash in aligned chunks.
+class TouchTraceRecorder {
+public:
+    static const uint16_t BLOCK_SIZE = 256;
+    static const uint8_t HEADER_SIZE = 16;
+    static const uint8_t MAX_RECORD_SIZE = 16;
+    static const uint8_t TRACE_BLOCK_MAGIC = 0x57;
+    static const uint8_t TRACE_FORMAT_VERSION = 1;
+
+    static const uint8_t TRACE_FLAG_ACCEPTED = 0x01;   // Filter verdict
+    static const uint8_t TRACE_FLAG_VALID = 0x02;      // TouchPoint.valid (clear = release)
+
+private:
+    uint8_t* storage;
+    uint16_t blockCount;
+    uint16_t screenWidth;
+    uint16_t screenHeight;
+
+    uint16_t openBlock;                  // Block receiving records
+    uint16_t openLength;                 // Bytes used in the open block
+    uint16_t oldestBlock;                // First completed block not yet flushed
+    uint16_t completedBlocks;            // Completed blocks waiting for flush()
+    uint32_t nextSequence;
+
+    // Delta state within the open block
+    int16_t lastX;
+    int16_t lastY;
+    uint32_t lastTime;                   // Timebase ticks, truncated to whole ms since baseTime
+
+    uint32_t recordedSamples;
+    uint32_t droppedBlocks;              // Overwritten before they were flushed
+
+    uint8_t* blockAt(uint16_t block) const;
+    void startBlock(uint32_t startTime);
+    void closeBlock();
+    static uint8_t writeVarint(uint8_t* out, uint32_t value);
+    static uint32_t zigzag(int32_t value);
+
+public:
+    TouchTraceRecorder();
+
+    // storage must hold at least two blocks; bytes past the last whole
+    // block are unused. Returns false if it is too small.
+    bool begin(uint8_t* storage, size_t size, uint16_t width, uint16_t height);
+    void clear();
+
+    // Append one sample and the filter's verdict for it
+    void record(const TouchPoint& touch, bool accepted);
+
+    // Close the open block early so flush() picks it up, e.g. before sleep
+    void finishBlock();
+
+    // Write up to maxBlocks completed blocks, oldest first, and free them.
+    // Call when idle - each block is one BLOCK_SIZE write to out.
+    size_t flush(Print& out, size_t maxBlocks = (size_t)-1);
+
+    uint16_t getPendingBlocks() const;
+    uint32_t getRecordedCount() const;
+    uint32_t getDroppedBlocks() const;
+};
+
+#endif // TOUCH_TRACE_RECORDER_H
\ No newline at end of file
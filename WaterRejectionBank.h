@@ -0,0 +1,234 @@
+/**
+ * WaterRejectionBank.h
+ * Optional multi-panel front end - drives several water rejection filters
+ * from one configuration preset and one update() call per loop
+ *
+ * Author: Assistant
+ * License: MIT
+ */
+
+#ifndef WATER_REJECTION_BANK_H
+#define WATER_REJECTION_BANK_H
+
+#include "WaterRejectionTouch.h"
+
+// Up to Panels filters (instances of Filter, owned by the caller) set up
+// from one preset, which begin() and setPreset() copy into each panel's own
+// configuration. The bank keeps the per-panel scheduling state as
+// parallel arrays, so update() is a single pass over Panels deadlines that
+// only calls into panels whose gesture window is due - an idle bank costs
+// one comparison per loop.
+//
+// Route touches through the bank so it sees each panel's new deadline. After
+// changing a panel's configuration directly, call refresh(panel).
+template <class Filter, uint8_t Panels>
+class WaterRejectionBankT {
+private:
+    static_assert(Panels > 0, "A bank needs at least one panel");
+
+    Filter* panels[Panels];
+    uint32_t deadlines[Panels];          // Per panel, WATER_REJECTION_NO_DEADLINE when idle
+    uint32_t bankDeadline;               // Earliest of deadlines[]
+    const WaterRejectionConfig* preset;
+
+    static bool isBefore(uint32_t time, uint32_t deadline);
+    void schedule(uint8_t panel, uint32_t deadline);
+    void recomputeDeadline();
+
+public:
+    WaterRejectionBankT();
+
+    // Add a filter as panel index. Returns false if index is out of range.
+    bool attach(uint8_t index, Filter* filter);
+    Filter* getPanel(uint8_t index) const;
+    uint8_t getPanelCount() const;
+
+    // begin() every attached panel with a copy of the preset (each panel's
+    // own configuration when nullptr). Later changes to the preset reach the
+    // panels only through setPreset().
+    void begin(const WaterRejectionConfig* preset = nullptr);
+
+    // Copy a new preset into every panel without clearing their state
+    void setPreset(const WaterRejectionConfig* preset);
+    const WaterRejectionConfig* getPreset() const;
+
+    // Per-panel processing - the same calls as on the filter
+    bool processTouch(uint8_t index, const TouchPoint& touch);
+    size_t processBatch(uint8_t index, const TouchPoint* touches, size_t count,
+                        uint8_t* verdicts = nullptr);
+    bool processMultiTouch(uint8_t index, TouchPoint* touches, uint8_t count);
+
+    // Re-read a panel's deadline after configuring it directly
+    void refresh(uint8_t index);
+
+    // Update every panel that is due. Returns the earliest deadline across
+    // the bank, or WATER_REJECTION_NO_DEADLINE when all panels are idle.
+    uint32_t update();
+    uint32_t nextDeadline() const;
+};
+
+// Default filter, up to four panels
+typedef WaterRejectionBankT<WaterRejectionTouch, 4> WaterRejectionBank;
+
+// WaterRejectionBankT implementation
+template <class Filter, uint8_t Panels>
+WaterRejectionBankT<Filter, Panels>::WaterRejectionBankT()
+    : bankDeadline(WATER_REJECTION_NO_DEADLINE), preset(nullptr) {
+    for (uint8_t i = 0; i < Panels; i++) {
+        panels[i] = nullptr;
+        deadlines[i] = WATER_REJECTION_NO_DEADLINE;
+    }
+}
+
+template <class Filter, uint8_t Panels>
+bool WaterRejectionBankT<Filter, Panels>::attach(uint8_t index, Filter* filter) {
+    if (index >= Panels) {
+        return false;
+    }
+    panels[index] = filter;
+    deadlines[index] = WATER_REJECTION_NO_DEADLINE;
+    if (filter) {
+        schedule(index, filter->nextDeadline());
+    } else {
+        recomputeDeadline();
+    }
+    return true;
+}
+
+template <class Filter, uint8_t Panels>
+Filter* WaterRejectionBankT<Filter, Panels>::getPanel(uint8_t index) const {
+    return index < Panels ? panels[index] : nullptr;
+}
+
+template <class Filter, uint8_t Panels>
+uint8_t WaterRejectionBankT<Filter, Panels>::getPanelCount() const {
+    return Panels;
+}
+
+template <class Filter, uint8_t Panels>
+void WaterRejectionBankT<Filter, Panels>::begin(const WaterRejectionConfig* sharedPreset) {
+    preset = sharedPreset;
+    for (uint8_t i = 0; i < Panels; i++) {
+        if (!panels[i]) {
+            continue;
+        }
+        if (preset) {
+            panels[i]->begin(*preset);
+        } else {
+            panels[i]->begin();
+        }
+        deadlines[i] = WATER_REJECTION_NO_DEADLINE;
+    }
+    bankDeadline = WATER_REJECTION_NO_DEADLINE;
+}
+
+template <class Filter, uint8_t Panels>
+void WaterRejectionBankT<Filter, Panels>::setPreset(const WaterRejectionConfig* sharedPreset) {
+    preset = sharedPreset;
+    if (!preset) {
+        return;
+    }
+    for (uint8_t i = 0; i < Panels; i++) {
+        if (panels[i]) {
+            panels[i]->setConfig(*preset);
+            deadlines[i] = panels[i]->nextDeadline();
+        }
+    }
+    recomputeDeadline();
+}
+
+template <class Filter, uint8_t Panels>
+const WaterRejectionConfig* WaterRejectionBankT<Filter, Panels>::getPreset() const {
+    return preset;
+}
+
+template <class Filter, uint8_t Panels>
+bool WaterRejectionBankT<Filter, Panels>::processTouch(uint8_t index, const TouchPoint& touch) {
+    if (index >= Panels || !panels[index]) {
+        return false;
+    }
+    bool accepted = panels[index]->processTouch(touch);
+    schedule(index, panels[index]->nextDeadline());
+    return accepted;
+}
+
+template <class Filter, uint8_t Panels>
+size_t WaterRejectionBankT<Filter, Panels>::processBatch(uint8_t index, const TouchPoint* touches,
+                                                         size_t count, uint8_t* verdicts) {
+    if (index >= Panels || !panels[index]) {
+        return 0;
+    }
+    size_t accepted = panels[index]->processBatch(touches, count, verdicts);
+    schedule(index, panels[index]->nextDeadline());
+    return accepted;
+}
+
+template <class Filter, uint8_t Panels>
+bool WaterRejectionBankT<Filter, Panels>::processMultiTouch(uint8_t index, TouchPoint* touches,
+                                                            uint8_t count) {
+    if (index >= Panels || !panels[index]) {
+        return false;
+    }
+    bool accepted = panels[index]->processMultiTouch(touches, count);
+    schedule(index, panels[index]->nextDeadline());
+    return accepted;
+}
+
+template <class Filter, uint8_t Panels>
+void WaterRejectionBankT<Filter, Panels>::refresh(uint8_t index) {
+    if (index < Panels && panels[index]) {
+        deadlines[index] = panels[index]->nextDeadline();
+        recomputeDeadline();
+    }
+}
+
+template <class Filter, uint8_t Panels>
+uint32_t WaterRejectionBankT<Filter, Panels>::update() {
+    uint32_t currentTime = waterRejectionNow();
+
+    // Nothing in any panel can expire before the bank deadline
+    if (bankDeadline == WATER_REJECTION_NO_DEADLINE || isBefore(currentTime, bankDeadline)) {
+        return bankDeadline;
+    }
+
+    for (uint8_t i = 0; i < Panels; i++) {
+        if (deadlines[i] != WATER_REJECTION_NO_DEADLINE && !isBefore(currentTime, deadlines[i])) {
+            deadlines[i] = panels[i]->update();
+        }
+    }
+    recomputeDeadline();
+    return bankDeadline;
+}
+
+template <class Filter, uint8_t Panels>
+uint32_t WaterRejectionBankT<Filter, Panels>::nextDeadline() const {
+    return bankDeadline;
+}
+
+template <class Filter, uint8_t Panels>
+bool WaterRejectionBankT<Filter, Panels>::isBefore(uint32_t time, uint32_t deadline) {
+    return (int32_t)(time - deadline) < 0;
+}
+
+// A panel's deadline only ever moves earlier between its update() calls
+template <class Filter, uint8_t Panels>
+void WaterRejectionBankT<Filter, Panels>::schedule(uint8_t panel, uint32_t deadline) {
+    deadlines[panel] = deadline;
+    if (deadline != WATER_REJECTION_NO_DEADLINE &&
+        (bankDeadline == WATER_REJECTION_NO_DEADLINE || isBefore(deadline, bankDeadline))) {
+        bankDeadline = deadline;
+    }
+}
+
+template <class Filter, uint8_t Panels>
+void WaterRejectionBankT<Filter, Panels>::recomputeDeadline() {
+    bankDeadline = WATER_REJECTION_NO_DEADLINE;
+    for (uint8_t i = 0; i < Panels; i++) {
+        if (deadlines[i] != WATER_REJECTION_NO_DEADLINE &&
+            (bankDeadline == WATER_REJECTION_NO_DEADLINE || isBefore(deadlines[i], bankDeadline))) {
+            bankDeadline = deadlines[i];
+        }
+    }
+}
+
+#endif // WATER_REJECTION_BANK_H
\ No newline at end of file
@@ -0,0 +1,268 @@
+/**
+ * WaterRejectionLVGL.h
+ * Optional LVGL input device adapter - registers a pointer indev whose
+ * read_cb drains a touch sample queue through a water rejection filter
+ *
+ * Author: Assistant
+ * License: MIT
+ */
+
+#ifndef WATER_REJECTION_LVGL_H
+#define WATER_REJECTION_LVGL_H
+
+#include <lvgl.h>
+#include "WaterRejectionTouch.h"
+
+// Pointer input device for LVGL 8 and 9. Samples reach it in one of two ways:
+//   - pushTouch()/pushRelease() from a touch interrupt or driver task, or
+//   - a polled source set with setTouchSource(), read once per indev period.
+// Each LVGL poll drains the whole backlog: every accepted touch and every
+// release is reported as its own reading through continue_reading, so short
+// taps and fast drags are not collapsed into one point per period. Rejected
+// samples are consumed silently. The adapter calls filter->update() itself.
+//
+// With setPrediction(lead) a drag is extrapolated from the smoothed finger
+// velocity up to lead ms past the last accepted sample, hiding the indev
+// period. Prediction stops as soon as the finger stalls or its samples are
+// rejected, so it never drifts past where the finger actually went.
+template <class Filter, uint8_t Capacity = 16>
+class WaterRejectionIndevT {
+private:
+    // Same as TouchEventHandler: hold the press across brief rejections,
+    // release once nothing has been accepted for this long
+    static const uint16_t RELEASE_TIMEOUT = 100;
+
+    Filter* filter;
+    TouchSampleQueueT<Capacity> samples;
+    bool (*touchSource)(TouchPoint& touch);
+
+    #if LVGL_VERSION_MAJOR < 9
+    lv_indev_drv_t indevDriver;
+    #endif
+    lv_indev_t* indev;
+
+    TouchPoint lastPoint;                // Last accepted touch, the reported position
+    bool pressed;
+    bool continuing;                     // Inside a continue_reading chain
+
+    // Prediction - velocities in Q8 px/ms
+    uint16_t predictionLead;             // 0 = off
+    int32_t velocityX;
+    int32_t velocityY;
+    bool velocityValid;
+
+    #if LVGL_VERSION_MAJOR >= 9
+    static void readCallback(lv_indev_t* indev, lv_indev_data_t* data);
+    #else
+    static void readCallback(lv_indev_drv_t* driver, lv_indev_data_t* data);
+    #endif
+    void read(lv_indev_data_t* data);
+    void accept(const TouchPoint& touch);
+    void predict(lv_point_t& point) const;
+
+public:
+    WaterRejectionIndevT(Filter* filter);
+
+    // Register the input device. Call after lv_init() and the display driver.
+    lv_indev_t* begin();
+    lv_indev_t* getIndev() const;
+
+    // Polled controllers: source fills in touch (at least x and y) and returns
+    // true while touched
+    void setTouchSource(bool (*source)(TouchPoint& touch));
+
+    // Producer side - safe to call from an ISR; a full queue drops the sample
+    bool pushTouch(const TouchPoint& touch) WRT_ISR_ATTR;
+    bool pushRelease() WRT_ISR_ATTR;
+
+    // Extrapolate drags by up to lead ms, typically the indev read period.
+    // 0 turns prediction off (the default).
+    void setPrediction(uint16_t lead);
+
+    bool isPressed() const;
+    uint32_t getDroppedCount() const;
+};
+
+// Default filter as an LVGL pointer
+typedef WaterRejectionIndevT<WaterRejectionTouch> WaterRejectionIndev;
+
+// WaterRejectionIndevT implementation
+template <class Filter, uint8_t Capacity>
+WaterRejectionIndevT<Filter, Capacity>::WaterRejectionIndevT(Filter* filter)
+    : filter(filter), touchSource(nullptr), indev(nullptr), pressed(false), continuing(false),
+      predictionLead(0), velocityX(0), velocityY(0), velocityValid(false) {
+    lastPoint = TouchPoint();
+}
+
+template <class Filter, uint8_t Capacity>
+lv_indev_t* WaterRejectionIndevT<Filter, Capacity>::begin() {
+    #if LVGL_VERSION_MAJOR >= 9
+    indev = lv_indev_create();
+    lv_indev_set_type(indev, LV_INDEV_TYPE_POINTER);
+    lv_indev_set_read_cb(indev, readCallback);
+    lv_indev_set_user_data(indev, this);
+    #else
+    lv_indev_drv_init(&indevDriver);
+    indevDriver.type = LV_INDEV_TYPE_POINTER;
+    indevDriver.read_cb = readCallback;
+    indevDriver.user_data = this;
+    indev = lv_indev_drv_register(&indevDriver);
+    #endif
+    return indev;
+}
+
+template <class Filter, uint8_t Capacity>
+lv_indev_t* WaterRejectionIndevT<Filter, Capacity>::getIndev() const {
+    return indev;
+}
+
+template <class Filter, uint8_t Capacity>
+void WaterRejectionIndevT<Filter, Capacity>::setTouchSource(bool (*source)(TouchPoint& touch)) {
+    touchSource = source;
+}
+
+template <class Filter, uint8_t Capacity>
+bool WaterRejectionIndevT<Filter, Capacity>::pushTouch(const TouchPoint& touch) {
+    return samples.push(touch);
+}
+
+template <class Filter, uint8_t Capacity>
+bool WaterRejectionIndevT<Filter, Capacity>::pushRelease() {
+    TouchPoint release = TouchPoint();
+    release.timestamp = waterRejectionNow();
+    release.valid = false;
+    return samples.push(release);
+}
+
+template <class Filter, uint8_t Capacity>
+void WaterRejectionIndevT<Filter, Capacity>::setPrediction(uint16_t lead) {
+    predictionLead = lead;
+}
+
+template <class Filter, uint8_t Capacity>
+bool WaterRejectionIndevT<Filter, Capacity>::isPressed() const {
+    return pressed;
+}
+
+template <class Filter, uint8_t Capacity>
+uint32_t WaterRejectionIndevT<Filter, Capacity>::getDroppedCount() const {
+    return samples.getDroppedCount();
+}
+
+#if LVGL_VERSION_MAJOR >= 9
+template <class Filter, uint8_t Capacity>
+void WaterRejectionIndevT<Filter, Capacity>::readCallback(lv_indev_t* indev, lv_indev_data_t* data) {
+    static_cast<WaterRejectionIndevT*>(lv_indev_get_user_data(indev))->read(data);
+}
+#else
+template <class Filter, uint8_t Capacity>
+void WaterRejectionIndevT<Filter, Capacity>::readCallback(lv_indev_drv_t* driver, lv_indev_data_t* data) {
+    static_cast<WaterRejectionIndevT*>(driver->user_data)->read(data);
+}
+#endif
+
+template <class Filter, uint8_t Capacity>
+void WaterRejectionIndevT<Filter, Capacity>::read(lv_indev_data_t* data) {
+    // Once per LVGL poll, not for every reading of a continue_reading chain
+    if (!continuing) {
+        filter->update();
+
+        if (touchSource) {
+            // Same defaults as processTouch(x, y) for what the source leaves out
+            TouchPoint touch = TouchPoint();
+            touch.x = 0;
+            touch.y = 0;
+            touch.timestamp = waterRejectionNow();
+            touch.pressure = 128;
+            touch.area = 10;
+            touch.valid = true;
+            if (touchSource(touch)) {
+                samples.push(touch);
+            } else if (pressed) {
+                pushRelease();
+            }
+        }
+
+        if (pressed &&
+            waterRejectionNow() - lastPoint.timestamp > waterRejectionTicks(RELEASE_TIMEOUT)) {
+            pressed = false;             // Everything since was rejected
+            velocityValid = false;
+        }
+    }
+
+    // Consume samples until one changes what LVGL should see
+    bool reported = false;
+    TouchPoint sample;
+    while (!reported && samples.pop(sample)) {
+        if (!sample.valid) {
+            reported = pressed;
+            pressed = false;
+            velocityValid = false;
+        } else if (filter->processTouch(sample)) {
+            accept(sample);
+            reported = true;
+        }
+    }
+
+    continuing = reported && !samples.isEmpty();
+    data->continue_reading = continuing;
+    data->point.x = lastPoint.x;
+    data->point.y = lastPoint.y;
+    data->state = pressed ? LV_INDEV_STATE_PRESSED : LV_INDEV_STATE_RELEASED;
+
+    // Only the final reading of a poll is predicted - the others are history
+    if (pressed && !continuing && predictionLead > 0) {
+        predict(data->point);
+    }
+}
+
+// Report an accepted touch and fold its motion into the velocity estimate
+template <class Filter, uint8_t Capacity>
+void WaterRejectionIndevT<Filter, Capacity>::accept(const TouchPoint& touch) {
+    if (!pressed) {
+        velocityValid = false;           // New press - no motion yet
+    } else {
+        uint32_t dt = touch.timestamp - lastPoint.timestamp;
+        if (dt > 0 && dt <= waterRejectionTicks(RELEASE_TIMEOUT)) {
+            const int32_t scale = 256 * (int32_t)WATER_REJECTION_TICKS_PER_MS;
+            int32_t vx = ((int32_t)(touch.x - lastPoint.x) * scale) / (int32_t)dt;
+            int32_t vy = ((int32_t)(touch.y - lastPoint.y) * scale) / (int32_t)dt;
+            if (velocityValid) {
+                velocityX = (velocityX + vx) / 2;
+                velocityY = (velocityY + vy) / 2;
+            } else {
+                velocityX = vx;
+                velocityY = vy;
+                velocityValid = true;
+            }
+        }
+    }
+
+    lastPoint = touch;
+    pressed = true;
+}
+
+template <class Filter, uint8_t Capacity>
+void WaterRejectionIndevT<Filter, Capacity>::predict(lv_point_t& point) const {
+    // A sample older than the lead means the finger stalled or is being
+    // rejected - report where it really is
+    if (!velocityValid ||
+        waterRejectionNow() - lastPoint.timestamp > waterRejectionTicks(predictionLead)) {
+        return;
+    }
+
+    int32_t x = lastPoint.x + velocityX * predictionLead / 256;
+    int32_t y = lastPoint.y + velocityY * predictionLead / 256;
+
+    #if LVGL_VERSION_MAJOR >= 9
+    int32_t width = lv_display_get_horizontal_resolution(NULL);
+    int32_t height = lv_display_get_vertical_resolution(NULL);
+    #else
+    int32_t width = lv_disp_get_hor_res(NULL);
+    int32_t height = lv_disp_get_ver_res(NULL);
+    #endif
+    point.x = x < 0 ? 0 : (x >= width ? width - 1 : x);
+    point.y = y < 0 ? 0 : (y >= height ? height - 1 : y);
+}
+
+#endif // WATER_REJECTION_LVGL_H
\ No newline at end of file
@@ -0,0 +1,52 @@
+/**
+ * WaterRejectionOptions.h
+ * Library-wide build options, included first by WaterRejectionTouch.h
+ *
+ * These options change the layout of the filter classes, so the sketch and
+ * the library's own .cpp files must all be compiled with the same set. The
+ * Arduino build does not pass a sketch's #defines to library sources, so
+ * never define them in the sketch. Either uncomment them here, or pass them
+ * to every file as global build flags, e.g.
+ *   PlatformIO:  build_flags = -DWATER_REJECTION_COMPACT_ZONES
+ *   arduino-cli: --build-property "build.extra_flags=-DWATER_REJECTION_COMPACT_ZONES"
+ * The option set is part of the library's type names, so a sketch built
+ * with a different set fails to link rather than running with mismatched
+ * objects.
+ *
+ * Author: Assistant
+ * License: MIT
+ */
+
+#ifndef WATER_REJECTION_OPTIONS_H
+#define WATER_REJECTION_OPTIONS_H
+
+// Run the multi-touch pattern checks with integer math only (no float/sqrt),
+// for MCUs without an FPU such as AVR and Cortex-M0
+// #define WATER_REJECTION_FIXED_POINT
+
+// Store the zone grid bit-packed (16-bit timestamps, 4-bit touch counts) for
+// boards with little RAM such as AVR and ESP8266
+// #define WATER_REJECTION_COMPACT_ZONES
+
+// Record min/avg/max cycle counts for each processTouch() stage, read back
+// with getProfile(). Compiles to nothing when not defined.
+// #define WATER_REJECTION_PROFILE
+
+// Add touch area and inter-touch interval histograms to getStatsSnapshot()
+// #define WATER_REJECTION_HISTOGRAMS
+
+// Compile out printDebugInfo(), printZoneMap() and the other Serial output
+// for production builds - use getStatsSnapshot()/serializeStats() instead
+// #define WATER_REJECTION_NO_DEBUG
+
+// Store the touch history as separate x, y and timestamp arrays (8 bytes per
+// entry instead of 16). The static check then compares two entries per
+// 32-bit word, with the ARMv7E-M dual 16-bit instructions on Cortex-M4/M7.
+// #define WATER_REJECTION_SOA_HISTORY
+
+// Run the filter on micros() instead of millis(), so samples from 200-400 Hz
+// controllers no longer share timestamps. TouchPoint::timestamp, update() and
+// nextDeadline() are then in us; configuration times stay in ms.
+// #define WATER_REJECTION_MICROS_TIMEBASE
+
+#endif // WATER_REJECTION_OPTIONS_H
\ No newline at end of file
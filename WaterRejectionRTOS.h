@@ -0,0 +1,423 @@
+/**
+ * WaterRejectionRTOS.h
+ * Optional FreeRTOS backend - runs a water rejection filter in its own task
+ * (e.g. on ESP32 core 0 while the UI renders on core 1) and publishes the
+ * latest accepted touch through a lock-free mailbox
+ *
+ * Author: Assistant
+ * License: MIT
+ */
+
+#ifndef WATER_REJECTION_RTOS_H
+#define WATER_REJECTION_RTOS_H
+
+#include "WaterRejectionTouch.h"
+
+#if defined(ESP32)
+  #include <freertos/FreeRTOS.h>
+  #include <freertos/task.h>
+  #include <freertos/queue.h>
+#elif !defined(INC_FREERTOS_H)
+  #error "WaterRejectionRTOS.h needs FreeRTOS - include your port's FreeRTOS.h, task.h and queue.h first"
+#endif
+
+// Task settings, read by start()
+struct WaterRejectionTaskConfig {
+    uint8_t queueLength = 16;            // Frames buffered between producers and the task
+    uint32_t stackSize = 4096;           // Task stack (bytes on ESP32, words on other ports)
+    UBaseType_t priority = 5;            // FreeRTOS task priority
+    int8_t core = 0;                     // Core to pin to (ESP32), -1 for no affinity
+    uint16_t updateInterval = 10;        // Minimum ms between filter update() calls
+};
+
+// Latest result published by the task
+struct WaterRejectionResult {
+    TouchPoint point;                    // Newest accepted touch
+    TouchEvent event;                    // Event for that touch (TOUCH_END on release)
+    bool pressed;                        // A valid touch is currently down
+    uint32_t sequence;                   // Bumped on every publish, 0 until the first one
+};
+
+// Task statistics. Fields are updated individually, so a reader on another
+// core may see a mix of two consecutive frames.
+struct WaterRejectionTaskStats {
+    uint32_t framesProcessed;
+    uint32_t framesDropped;              // Queue was full when a producer submitted
+    uint8_t queueHighWater;              // Deepest backlog seen by the task
+    uint32_t minProcessMicros;
+    uint32_t avgProcessMicros;
+    uint32_t maxProcessMicros;
+};
+
+// Runs Filter (a WaterRejectionTouchT instantiation) in a dedicated task.
+// Producers submit single points, multi-touch frames or releases from any
+// task or ISR; the UI polls getLatest() without ever blocking on the filter.
+// Between frames the task blocks until the filter's next deadline, so an
+// idle screen costs no CPU.
+// Once start() has been called only the task touches the filter - configure
+// it beforehand.
+template <class Filter, uint8_t FramePoints = 5>
+class WaterRejectionTaskT {
+private:
+    static_assert(FramePoints > 0, "Frames must hold at least one touch");
+
+    struct TouchFrame {
+        TouchPoint points[FramePoints];
+        uint8_t count;                   // 0 = release, 1 = single touch, more = multi-touch
+    };
+    
+    static const uint8_t WAKE_FRAME = 0xFF;  // count used by stop() to wake the task
+
+    Filter* filter;
+    WaterRejectionTaskConfig taskConfig;
+    QueueHandle_t frameQueue;
+    TaskHandle_t taskHandle;
+    volatile bool stopRequested;
+
+    // Seqlock mailbox - odd sequence while the task is writing
+    uint32_t mailboxSequence;
+    WaterRejectionResult mailbox;
+
+    uint32_t droppedFrames;              // Written by producers with atomic adds
+    WaterRejectionTaskStats stats;
+    uint64_t totalProcessMicros;
+
+    static void taskEntry(void* param);
+    void run();
+    TickType_t ticksUntil(uint32_t deadline, uint32_t lastUpdate) const;
+    void processFrame(TouchFrame& frame);
+    void publish(const TouchPoint& point, TouchEvent event, bool pressed);
+    bool submitFrame(const TouchFrame& frame);
+    bool submitFrameFromISR(const TouchFrame& frame);
+
+public:
+    WaterRejectionTaskT(Filter* filter);
+    ~WaterRejectionTaskT();
+
+    // Create the queue and task. Returns false if either allocation failed.
+    bool start();
+    bool start(const WaterRejectionTaskConfig& config);
+    void stop();
+    bool isRunning() const;
+
+    // Producer side - never blocks; a full queue drops the frame
+    bool submitTouch(const TouchPoint& touch);
+    bool submitMultiTouch(const TouchPoint* touches, uint8_t count);
+    bool submitRelease();
+    bool submitTouchFromISR(const TouchPoint& touch);
+    bool submitReleaseFromISR();
+
+    // Consumer side - copies the newest result. Returns false when the task
+    // was mid-publish on every retry; keep the previous result in that case.
+    bool getLatest(WaterRejectionResult& result) const;
+
+    WaterRejectionTaskStats getStats() const;
+    void resetStats();
+};
+
+// Default filter in its own task
+typedef WaterRejectionTaskT<WaterRejectionTouch> WaterRejectionTask;
+
+// WaterRejectionTaskT implementation
+template <class Filter, uint8_t FramePoints>
+WaterRejectionTaskT<Filter, FramePoints>::WaterRejectionTaskT(Filter* filter)
+    : filter(filter), frameQueue(NULL), taskHandle(NULL), stopRequested(false),
+      mailboxSequence(0), droppedFrames(0) {
+    mailbox = WaterRejectionResult();
+    resetStats();
+}
+
+template <class Filter, uint8_t FramePoints>
+WaterRejectionTaskT<Filter, FramePoints>::~WaterRejectionTaskT() {
+    stop();
+}
+
+template <class Filter, uint8_t FramePoints>
+bool WaterRejectionTaskT<Filter, FramePoints>::start() {
+    return start(taskConfig);
+}
+
+template <class Filter, uint8_t FramePoints>
+bool WaterRejectionTaskT<Filter, FramePoints>::start(const WaterRejectionTaskConfig& config) {
+    if (taskHandle) {
+        return true;  // Already running
+    }
+
+    taskConfig = config;
+    frameQueue = xQueueCreate(taskConfig.queueLength, sizeof(TouchFrame));
+    if (!frameQueue) {
+        return false;
+    }
+
+    stopRequested = false;
+    BaseType_t created;
+    #if defined(ESP32)
+    created = xTaskCreatePinnedToCore(taskEntry, "WaterRejection", taskConfig.stackSize, this,
+                                      taskConfig.priority, &taskHandle,
+                                      taskConfig.core < 0 ? tskNO_AFFINITY : taskConfig.core);
+    #else
+    created = xTaskCreate(taskEntry, "WaterRejection", taskConfig.stackSize, this,
+                          taskConfig.priority, &taskHandle);
+    #endif
+
+    if (created != pdPASS) {
+        taskHandle = NULL;
+        vQueueDelete(frameQueue);
+        frameQueue = NULL;
+        return false;
+    }
+    return true;
+}
+
+template <class Filter, uint8_t FramePoints>
+void WaterRejectionTaskT<Filter, FramePoints>::stop() {
+    if (!taskHandle) {
+        return;
+    }
+
+    // Let the task finish its current frame and exit on its own, so it is
+    // never deleted halfway through a filter call or a publish. It may be
+    // blocked with no deadline, so wake it; if the queue is full it is busy anyway.
+    stopRequested = true;
+    TouchFrame wake;
+    wake.count = WAKE_FRAME;
+    xQueueSendToFront(frameQueue, &wake, 0);
+    while (__atomic_load_n(&taskHandle, __ATOMIC_ACQUIRE)) {
+        vTaskDelay(1);
+    }
+
+    vQueueDelete(frameQueue);
+    frameQueue = NULL;
+}
+
+template <class Filter, uint8_t FramePoints>
+bool WaterRejectionTaskT<Filter, FramePoints>::isRunning() const {
+    return taskHandle != NULL;
+}
+
+template <class Filter, uint8_t FramePoints>
+void WaterRejectionTaskT<Filter, FramePoints>::taskEntry(void* param) {
+    static_cast<WaterRejectionTaskT*>(param)->run();
+}
+
+template <class Filter, uint8_t FramePoints>
+void WaterRejectionTaskT<Filter, FramePoints>::run() {
+    uint32_t lastUpdate = waterRejectionNow();
+    uint32_t deadline = filter->update();
+    TouchFrame frame;
+
+    while (!stopRequested) {
+        if (xQueueReceive(frameQueue, &frame, ticksUntil(deadline, lastUpdate)) == pdTRUE &&
+            frame.count != WAKE_FRAME) {
+            uint8_t depth = (uint8_t)uxQueueMessagesWaiting(frameQueue) + 1;
+            if (depth > stats.queueHighWater) {
+                stats.queueHighWater = depth;
+            }
+            processFrame(frame);
+        }
+
+        // update() returns at once until its deadline, so calling it after
+        // every frame is cheap; the interval only caps how often it runs
+        uint32_t now = waterRejectionNow();
+        if (now - lastUpdate >= waterRejectionTicks(taskConfig.updateInterval)) {
+            deadline = filter->update();
+            lastUpdate = now;
+        } else {
+            deadline = filter->nextDeadline();
+        }
+    }
+
+    __atomic_store_n(&taskHandle, (TaskHandle_t)NULL, __ATOMIC_RELEASE);
+    vTaskDelete(NULL);
+}
+
+// Ticks to block for: until the filter deadline, but not before the next
+// update() the interval allows, and forever when the filter is idle
+template <class Filter, uint8_t FramePoints>
+TickType_t WaterRejectionTaskT<Filter, FramePoints>::ticksUntil(uint32_t deadline,
+                                                                 uint32_t lastUpdate) const {
+    if (deadline == WATER_REJECTION_NO_DEADLINE) {
+        return portMAX_DELAY;
+    }
+
+    uint32_t earliest = lastUpdate + waterRejectionTicks(taskConfig.updateInterval);
+    if ((int32_t)(deadline - earliest) < 0) {
+        deadline = earliest;
+    }
+
+    int32_t remaining = (int32_t)(deadline - waterRejectionNow());
+    if (remaining <= 0) {
+        return 0;
+    }
+    // Round up a partial ms and a partial tick
+    uint32_t remainingMs = ((uint32_t)remaining + WATER_REJECTION_TICKS_PER_MS - 1) /
+                           WATER_REJECTION_TICKS_PER_MS;
+    return pdMS_TO_TICKS(remainingMs) + 1;
+}
+
+template <class Filter, uint8_t FramePoints>
+void WaterRejectionTaskT<Filter, FramePoints>::processFrame(TouchFrame& frame) {
+    uint32_t start = micros();
+
+    // Every frame, single points and releases included, goes through
+    // processMultiTouch() so contacts are followed and released on count 0
+    uint8_t verdicts[FramePoints];
+    filter->processMultiTouch(frame.points, frame.count, waterRejectionNow(), verdicts);
+
+    if (frame.count == 0) {
+        // Release - lets getTouchEvent() report the end of the touch
+        TouchPoint released = mailbox.point;
+        released.valid = false;
+        TouchEvent event = filter->getTouchEvent(released);
+        if (event == TOUCH_END) {
+            publish(mailbox.point, event, false);
+        }
+    } else {
+        // The first accepted contact drives the published pointer - a
+        // rejected droplet in slot 0 must not move it
+        for (uint8_t i = 0; i < frame.count; i++) {
+            if (verdicts[i]) {
+                publish(frame.points[i], filter->getTouchEvent(frame.points[i]), true);
+                break;
+            }
+        }
+    }
+
+    uint32_t elapsed = micros() - start;
+    stats.framesProcessed++;
+    totalProcessMicros += elapsed;
+    stats.avgProcessMicros = totalProcessMicros / stats.framesProcessed;
+    if (elapsed < stats.minProcessMicros) {
+        stats.minProcessMicros = elapsed;
+    }
+    if (elapsed > stats.maxProcessMicros) {
+        stats.maxProcessMicros = elapsed;
+    }
+}
+
+template <class Filter, uint8_t FramePoints>
+void WaterRejectionTaskT<Filter, FramePoints>::publish(const TouchPoint& point, TouchEvent event,
+                                                       bool pressed) {
+    // Single writer: mark the mailbox busy, write, then release the new sequence
+    uint32_t sequence = mailboxSequence;
+    __atomic_store_n(&mailboxSequence, sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    mailbox.point = point;
+    mailbox.event = event;
+    mailbox.pressed = pressed;
+    mailbox.sequence = (sequence + 2) / 2;
+
+    __atomic_store_n(&mailboxSequence, sequence + 2, __ATOMIC_RELEASE);
+}
+
+template <class Filter, uint8_t FramePoints>
+bool WaterRejectionTaskT<Filter, FramePoints>::getLatest(WaterRejectionResult& result) const {
+    // The writer holds the mailbox for a few stores; if it is preempted there
+    // give up rather than spin against it on the same core
+    const uint8_t MAX_RETRIES = 4;
+
+    for (uint8_t attempt = 0; attempt < MAX_RETRIES; attempt++) {
+        uint32_t before = __atomic_load_n(&mailboxSequence, __ATOMIC_ACQUIRE);
+        if (before & 1) {
+            continue;
+        }
+
+        result = mailbox;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+        if (__atomic_load_n(&mailboxSequence, __ATOMIC_RELAXED) == before) {
+            return true;
+        }
+    }
+    return false;
+}
+
+template <class Filter, uint8_t FramePoints>
+bool WaterRejectionTaskT<Filter, FramePoints>::submitFrame(const TouchFrame& frame) {
+    if (!frameQueue || xQueueSend(frameQueue, &frame, 0) != pdTRUE) {
+        __atomic_fetch_add(&droppedFrames, 1, __ATOMIC_RELAXED);
+        return false;
+    }
+    return true;
+}
+
+template <class Filter, uint8_t FramePoints>
+bool WaterRejectionTaskT<Filter, FramePoints>::submitFrameFromISR(const TouchFrame& frame) {
+    BaseType_t woken = pdFALSE;
+    if (!frameQueue || xQueueSendFromISR(frameQueue, &frame, &woken) != pdTRUE) {
+        __atomic_fetch_add(&droppedFrames, 1, __ATOMIC_RELAXED);
+        return false;
+    }
+    if (woken) {
+        portYIELD_FROM_ISR();
+    }
+    return true;
+}
+
+template <class Filter, uint8_t FramePoints>
+bool WaterRejectionTaskT<Filter, FramePoints>::submitTouch(const TouchPoint& touch) {
+    return submitMultiTouch(&touch, 1);
+}
+
+template <class Filter, uint8_t FramePoints>
+bool WaterRejectionTaskT<Filter, FramePoints>::submitMultiTouch(const TouchPoint* touches,
+                                                                uint8_t count) {
+    if (count == 0) {
+        return submitRelease();
+    }
+
+    // Frames hold at most FramePoints touches - size FramePoints to the
+    // controller so larger reports never reach this point
+    if (count > FramePoints) {
+        __atomic_fetch_add(&droppedFrames, 1, __ATOMIC_RELAXED);
+        return false;
+    }
+
+    TouchFrame frame;
+    memcpy(frame.points, touches, count * sizeof(TouchPoint));
+    frame.count = count;
+    return submitFrame(frame);
+}
+
+template <class Filter, uint8_t FramePoints>
+bool WaterRejectionTaskT<Filter, FramePoints>::submitRelease() {
+    TouchFrame frame;
+    frame.count = 0;
+    return submitFrame(frame);
+}
+
+template <class Filter, uint8_t FramePoints>
+bool WaterRejectionTaskT<Filter, FramePoints>::submitTouchFromISR(const TouchPoint& touch) {
+    TouchFrame frame;
+    frame.points[0] = touch;
+    frame.count = 1;
+    return submitFrameFromISR(frame);
+}
+
+template <class Filter, uint8_t FramePoints>
+bool WaterRejectionTaskT<Filter, FramePoints>::submitReleaseFromISR() {
+    TouchFrame frame;
+    frame.count = 0;
+    return submitFrameFromISR(frame);
+}
+
+template <class Filter, uint8_t FramePoints>
+WaterRejectionTaskStats WaterRejectionTaskT<Filter, FramePoints>::getStats() const {
+    WaterRejectionTaskStats snapshot = stats;
+    snapshot.framesDropped = __atomic_load_n(&droppedFrames, __ATOMIC_RELAXED);
+    if (snapshot.framesProcessed == 0) {
+        snapshot.minProcessMicros = 0;
+    }
+    return snapshot;
+}
+
+template <class Filter, uint8_t FramePoints>
+void WaterRejectionTaskT<Filter, FramePoints>::resetStats() {
+    memset(&stats, 0, sizeof(stats));
+    stats.minProcessMicros = 0xFFFFFFFF;
+    totalProcessMicros = 0;
+    __atomic_store_n(&droppedFrames, 0, __ATOMIC_RELAXED);
+}
+
+#endif // WATER_REJECTION_RTOS_H
\ No newline at end of file
@@ -11,6 +11,7 @@
 #define WATER_REJECTION_TOUCH_H
 
 #include <Arduino.h>
+#include "WaterRejectionOptions.h"
 
 // Screen type definitions - user should define one of these before including this library
 // If none defined, defaults to CAPACITIVE_SCREEN
@@ -23,14 +24,97 @@
   #error "Please define only one screen type: either RESISTIVE_SCREEN or CAPACITIVE_SCREEN"
 #endif
 
-// Touch point structure
+// Build options (WATER_REJECTION_COMPACT_ZONES, _FIXED_POINT, _PROFILE,
+// _HISTOGRAMS, _NO_DEBUG, _SOA_HISTORY, _MICROS_TIMEBASE) are library-wide -
+// see WaterRejectionOptions.h
+
+#ifdef WATER_REJECTION_MICROS_TIMEBASE
+  #define WATER_REJECTION_TICKS_PER_MS 1000UL
+#else
+  #define WATER_REJECTION_TICKS_PER_MS 1UL
+#endif
+
+// Everything below lives in an inline namespace named after the option set,
+// so objects built with different options cannot be linked together
+#ifdef WATER_REJECTION_COMPACT_ZONES
+  #define WRT_ABI_COMPACT c1
+#else
+  #define WRT_ABI_COMPACT c0
+#endif
+#ifdef WATER_REJECTION_FIXED_POINT
+  #define WRT_ABI_MATH f1
+#else
+  #define WRT_ABI_MATH f0
+#endif
+#ifdef WATER_REJECTION_PROFILE
+  #define WRT_ABI_PROFILE p1
+#else
+  #define WRT_ABI_PROFILE p0
+#endif
+#ifdef WATER_REJECTION_HISTOGRAMS
+  #define WRT_ABI_HISTOGRAMS h1
+#else
+  #define WRT_ABI_HISTOGRAMS h0
+#endif
+#ifdef WATER_REJECTION_NO_DEBUG
+  #define WRT_ABI_DEBUG d0
+#else
+  #define WRT_ABI_DEBUG d1
+#endif
+#ifdef WATER_REJECTION_SOA_HISTORY
+  #define WRT_ABI_HISTORY s1
+#else
+  #define WRT_ABI_HISTORY s0
+#endif
+#ifdef WATER_REJECTION_MICROS_TIMEBASE
+  #define WRT_ABI_TIMEBASE u1
+#else
+  #define WRT_ABI_TIMEBASE u0
+#endif
+
+#define WRT_ABI_JOIN(c, f, p, h, d, s, u) wrt_##c##f##p##h##d##s##u
+#define WRT_ABI_NAME(c, f, p, h, d, s, u) WRT_ABI_JOIN(c, f, p, h, d, s, u)
+#define WRT_ABI_NAMESPACE WRT_ABI_NAME(WRT_ABI_COMPACT, WRT_ABI_MATH, WRT_ABI_PROFILE, \
+                                       WRT_ABI_HISTOGRAMS, WRT_ABI_DEBUG, WRT_ABI_HISTORY, \
+                                       WRT_ABI_TIMEBASE)
+
+inline namespace WRT_ABI_NAMESPACE {
+
+// Current time in the filter's timebase - use it to stamp TouchPoints.
+// Both clocks wrap (micros() every 71 minutes); the filter only ever
+// compares differences of timestamps, so the wrap is harmless.
+inline uint32_t waterRejectionNow() {
+    #ifdef WATER_REJECTION_MICROS_TIMEBASE
+    return micros();
+    #else
+    return millis();
+    #endif
+}
+
+// ms to timebase ticks
+inline uint32_t waterRejectionTicks(uint32_t ms) {
+    return ms * WATER_REJECTION_TICKS_PER_MS;
+}
+
+// Returned by update()/nextDeadline() when no timer is pending - nothing
+// will change until the next touch
+#define WATER_REJECTION_NO_DEADLINE 0xFFFFFFFFUL
+
+// TouchPoint::flags bits, set by controller drivers (TouchControllers.h)
+#define TOUCH_FLAG_HW_AREA   0x01        // area and pressure were measured by the controller
+#define TOUCH_FLAG_HW_WATER  0x02        // The controller flagged the contact as water
+
+// Touch point structure. Start from TouchPoint() (or {...}) when filling one
+// by hand, so flags and id are 0 rather than whatever was on the stack.
 struct TouchPoint {
     int16_t x;
     int16_t y;
-    uint32_t timestamp;
+    uint32_t timestamp;                  // waterRejectionNow() when sampled
     uint8_t pressure;
     uint16_t area;
     bool valid;
+    uint8_t id;                          // Contact ID set by processMultiTouch() (0 = untracked)
+    uint8_t flags;                       // TOUCH_FLAG_* bits, in what was padding
 };
 
 // Touch event types
@@ -42,6 +126,105 @@ enum TouchEvent {
     TOUCH_INVALID
 };
 
+// Start/move/end state machine for one touch stream. Each filter instance,
+// event handler or contact owns its own, so instances never share state.
+class TouchEventTracker {
+private:
+    TouchPoint lastTouch;                // Position of the last START/MOVE
+    bool pressed;
+    
+public:
+    TouchEventTracker();
+    
+    // Classify current (valid = false reports a release). minMovement is the
+    // distance on either axis that counts as TOUCH_MOVE.
+    TouchEvent update(const TouchPoint& current, uint16_t minMovement);
+    void reset();
+    bool isPressed() const;
+};
+
+// Why a touch was rejected. Reasons from REJECT_AREA on are water
+// detections and also count towards getWaterDropletsRejected().
+enum RejectReason {
+    REJECT_NONE,
+    REJECT_BOUNDS,                       // Outside the screen
+    REJECT_PRESSURE,                     // Below pressureThreshold (resistive)
+    REJECT_DEBOUNCE,                     // Moved within debounceTime (resistive)
+    REJECT_GESTURE,                      // Waiting for the unlock gesture
+    REJECT_AREA,                         // Contact larger than maxTouchArea
+    REJECT_ZONE_BURST,                   // Rapid repeated touches in one zone
+    REJECT_NEIGHBOR_SPREAD,              // Too many active neighbouring zones
+    REJECT_STATIC,                       // Touch is not moving
+    REJECT_TOUCH_COUNT,                  // More than maxSimultaneousTouches
+    REJECT_CLUSTER,                      // Multi-touch points tightly clustered
+    REJECT_LINE,                         // Multi-touch points form a line
+    REJECT_STREAK,                       // Slow straight drift, like water running down
+    REJECT_WIDE_SPREAD,                  // Active zones across more than maxActiveRegions
+    REJECT_HARDWARE,                     // Controller reported water (TOUCH_FLAG_HW_WATER)
+    REJECT_REASON_COUNT
+};
+
+#ifdef WATER_REJECTION_HISTOGRAMS
+// Log2 bins: bin 0 holds 0, bin n holds [2^(n-1), 2^n), the last bin everything above
+static const uint8_t STATS_AREA_BINS = 10;           // Up to 256+
+static const uint8_t STATS_INTERVAL_BINS = 12;       // Up to 1024+ ms
+#endif
+
+// Plain copy of the filter statistics, cheap to take from the loop
+struct WaterRejectionStats {
+    uint32_t validTouches;
+    uint32_t waterDropletsRejected;
+    uint32_t rejectCounts[REJECT_REASON_COUNT];      // Indexed by RejectReason
+    #ifdef WATER_REJECTION_HISTOGRAMS
+    uint32_t areaHistogram[STATS_AREA_BINS];         // Area of every in-bounds touch
+    uint32_t intervalHistogram[STATS_INTERVAL_BINS]; // ms between consecutive touches
+    #endif
+};
+
+// Gestures that unlock requireGesture mode. Each is enabled with its own
+// unlock time by setGestureUnlock(); by default only UNLOCK_SWIPE_RIGHT is,
+// for 30 s. Swipes run swipeMinDistance from within edgeSwipeThreshold of
+// their starting edge, all within gestureTimeout.
+enum UnlockGesture {
+    UNLOCK_SWIPE_RIGHT,                  // From the left edge
+    UNLOCK_SWIPE_LEFT,                   // From the right edge
+    UNLOCK_SWIPE_DOWN,                   // From the top edge
+    UNLOCK_SWIPE_UP,                     // From the bottom edge
+    UNLOCK_L_SHAPE,                      // Down then right, each leg swipeMinDistance
+    UNLOCK_TWO_FINGER_HOLD,              // Two still fingers for gestureHoldTime
+    UNLOCK_GESTURE_COUNT,
+    UNLOCK_NONE = 0xFF
+};
+
+// Direction a streak must drift in to count as water, in screen coordinates
+enum StreakDirection {
+    STREAK_ANY,
+    STREAK_DOWN,                         // +y
+    STREAK_UP,                           // -y
+    STREAK_RIGHT,                        // +x
+    STREAK_LEFT                          // -x
+};
+
+// Streak detector settings, taken from WaterRejectionConfig
+struct StreakLimits {
+    uint32_t window;                     // Timebase ticks
+    uint8_t minSamples;
+    uint16_t minSpeed;
+    uint16_t maxSpeed;
+    uint8_t direction;
+};
+
+// Q8 weights of the classifyTouch() features. Each feature is 0 up to half
+// the limit processTouch() rejects at and reaches 128 there, so a weight of
+// 256 lets it decide by itself; lower weights need other evidence to add up.
+struct WaterScoreWeights {
+    uint16_t area = 256;                 // Contact area against maxTouchArea
+    uint16_t zoneBurst = 256;            // Repeated touches in one zone
+    uint16_t spread = 256;               // Active neighbours, and regions if enabled
+    uint16_t staticTouch = 256;          // Touches resting in the history
+    uint16_t streak = 256;               // Slow straight drift
+};
+
 // Configuration structure with screen-type specific defaults
 struct WaterRejectionConfig {
     #ifdef RESISTIVE_SCREEN
@@ -55,8 +238,20 @@ struct WaterRejectionConfig {
     bool requireGesture = false;         // Usually not needed for resistive
     uint16_t edgeSwipeThreshold = 50;    // Same edge threshold
     uint16_t swipeMinDistance = 150;     // Same swipe distance
+    uint16_t gestureHoldTime = 1000;     // Two-finger hold unlock (ms)
     uint16_t debounceTime = 50;          // Resistive needs debouncing
     uint16_t pressureThreshold = 300;    // Minimum pressure for resistive
+    uint16_t contactMatchDistance = 40;  // Max px a contact moves between frames
+    uint16_t streakWindow = 0;           // Streak detection window (ms), 0 = off
+    uint8_t streakMinSamples = 4;        // Accepted touches needed to call a streak
+    uint16_t streakMinSpeed = 5;         // Slowest drift treated as water (px/s)
+    uint16_t streakMaxSpeed = 150;       // Fastest drift treated as water (px/s)
+    uint8_t streakDirection = STREAK_DOWN;   // Which way water runs on the mounted panel
+    uint8_t maxActiveRegions = 0;        // Coarse 5x5 regions holding active zones before
+                                         // a touch counts as a sheet of water, 0 = off
+    uint8_t scoreThreshold = 128;        // classifyTouch() score from which a touch is
+                                         // treated as water and not tracked
+    WaterScoreWeights scoreWeights;
     
     #else  // CAPACITIVE_SCREEN (default)
     // Capacitive screen defaults - stricter filtering
@@ -69,38 +264,290 @@ struct WaterRejectionConfig {
     bool requireGesture = false;         // Require gesture to activate
     uint16_t edgeSwipeThreshold = 50;    // Pixels from edge for swipe start
     uint16_t swipeMinDistance = 150;     // Minimum swipe distance
+    uint16_t gestureHoldTime = 1000;     // Two-finger hold unlock (ms)
     uint16_t debounceTime = 0;           // Capacitive doesn't need debouncing
     uint16_t pressureThreshold = 0;      // Not used for capacitive
+    uint16_t contactMatchDistance = 40;  // Max px a contact moves between frames
+    uint16_t streakWindow = 0;           // Streak detection window (ms), 0 = off
+    uint8_t streakMinSamples = 4;        // Accepted touches needed to call a streak
+    uint16_t streakMinSpeed = 5;         // Slowest drift treated as water (px/s)
+    uint16_t streakMaxSpeed = 150;       // Fastest drift treated as water (px/s)
+    uint8_t streakDirection = STREAK_DOWN;   // Which way water runs on the mounted panel
+    uint8_t maxActiveRegions = 0;        // Coarse 5x5 regions holding active zones before
+                                         // a touch counts as a sheet of water, 0 = off
+    uint8_t scoreThreshold = 128;        // classifyTouch() score from which a touch is
+                                         // treated as water and not tracked
+    WaterScoreWeights scoreWeights;
     #endif
 };
 
-class WaterRejectionTouch {
+// Chronological ring of accepted touches. Keeps an incremental window of the
+// entries younger than maxStaticTime plus a histogram of their distances from
+// an anchor point, so most static touch checks are settled without a scan.
+// A second window of the entries younger than the streak window carries
+// running sums for a line fit, so the streak check is O(1) per touch too.
+template <uint8_t N>
+class TouchHistoryT {
 private:
+    static const uint8_t MAX_TRACKED_MOVEMENT = 16;   // Larger minMovement always scans
+    static const uint8_t FAR_ENTRY = 0xFF;
+    
+    #ifdef WATER_REJECTION_SOA_HISTORY
+    uint32_t entryTimes[N];
+    int16_t entryX[N];
+    int16_t entryY[N];
+    uint8_t entryValid[(N + 7) / 8];     // One bit per slot
+    #else
+    TouchPoint entries[N];
+    #endif
+    uint8_t head;                        // Next slot to write
+    uint8_t count;                       // Slots written (saturates at N)
+    
+    // Static window - newest windowCount entries, oldest at windowStart
+    uint8_t windowStart;
+    uint8_t windowCount;
+    uint32_t windowTime;                 // maxStaticTime the window was trimmed with
+    
+    // Chebyshev distance of each window entry from the anchor (FAR_ENTRY when
+    // 2 * minMovement or more away) and how many entries sit at each distance
+    int16_t anchorX;
+    int16_t anchorY;
+    uint16_t anchorMovement;
+    bool anchorValid;
+    uint8_t slotDistance[N];
+    uint8_t distanceCounts[2 * MAX_TRACKED_MOVEMENT];
+    
+    // Streak window - newest streakCount entries, oldest at streakStart.
+    // Sums are relative to the oldest entry and rebased when it drops out;
+    // they stay exact while N * span^2 < 2^31 (any N on screens to 2896 px).
+    uint8_t streakStart;
+    uint8_t streakCount;
+    uint32_t streakTime;                 // Window the sums were built for, 0 = off
+    int16_t streakOriginX;
+    int16_t streakOriginY;
+    int32_t streakSumX;
+    int32_t streakSumY;
+    int32_t streakSumXX;
+    int32_t streakSumYY;
+    int32_t streakSumXY;
+    uint32_t streakPath;                 // Sum of the steps between window entries
+    
+    // Entry fields - the same for either layout
+    int16_t xAt(uint8_t index) const;
+    int16_t yAt(uint8_t index) const;
+    uint32_t timeAt(uint8_t index) const;
+    bool validAt(uint8_t index) const;
+    void store(uint8_t index, const TouchPoint& touch);
+    
+    static uint8_t next(uint8_t index);
+    uint32_t distanceFromAnchor(int16_t x, int16_t y) const;
+    void addToAnchor(uint8_t index);
+    void removeFromAnchor(uint8_t index);
+    void setAnchor(const TouchPoint& touch, uint16_t minMovement);
+    void dropOldest();
+    bool scanStatic(const TouchPoint& touch, uint16_t minMovement,
+                    uint32_t maxStaticTime, uint8_t maxStaticCount) const;
+    #ifdef WATER_REJECTION_SOA_HISTORY
+    static uint32_t nearPair(uint32_t packed, uint32_t touch, uint32_t limit);
+    bool isStaticEntry(uint8_t index, uint32_t timestamp, uint32_t maxStaticTime) const;
+    uint8_t scanRun(uint8_t from, uint8_t to, const TouchPoint& touch, uint16_t minMovement,
+                    uint32_t maxStaticTime, uint8_t needed) const;
+    #endif
+    static uint8_t previous(uint8_t index);
+    static uint32_t stepLength(int16_t fromX, int16_t fromY, int16_t toX, int16_t toY);
+    void resetStreak();
+    void addToStreak(uint8_t index);
+    void dropStreakOldest();
+    void rebuildStreak();
+    
+public:
+    TouchHistoryT();
+    
+    void clear();
+    void push(const TouchPoint& touch);
+    
+    // Move every stored timestamp by shift ticks (restoring a snapshot)
+    void rebase(uint32_t shift);
+    
+    // True when more than maxStaticCount entries younger than maxStaticTime
+    // (timebase ticks) lie within minMovement of the touch on both axes
+    bool isStatic(const TouchPoint& touch, uint16_t minMovement,
+                  uint32_t maxStaticTime, uint8_t maxStaticCount);
+    
+    // True when the entries younger than limits.window plus the touch drift
+    // in a straight, monotonic line at a speed between the limits
+    bool isStreak(const TouchPoint& touch, const StreakLimits& limits);
+};
+
+// Code called from interrupt handlers must sit in IRAM on ESP32/ESP8266
+#if defined(ESP32) || defined(ESP8266)
+  #define WRT_ISR_ATTR IRAM_ATTR
+#else
+  #define WRT_ISR_ATTR
+#endif
+
+// Single-producer/single-consumer lock-free queue of touch samples. The touch
+// interrupt (or a driver task) pushes, the loop drains it into the filter.
+// Capacity must be a power of two up to 128 so the 8-bit indices wrap cleanly.
+template <uint8_t Capacity>
+class TouchSampleQueueT {
+private:
+    static_assert(Capacity >= 2 && Capacity <= 128 && (Capacity & (Capacity - 1)) == 0,
+                  "Queue capacity must be a power of two between 2 and 128");
+    
+    TouchPoint samples[Capacity];
+    uint8_t head;                        // Free-running, written by the producer only
+    uint8_t tail;                        // Free-running, written by the consumer only
+    uint32_t droppedSamples;             // Written by the producer only
+    
+public:
+    TouchSampleQueueT();
+    
+    // Producer side - safe to call from an ISR
+    bool push(const TouchPoint& sample) WRT_ISR_ATTR;
+    
+    // Consumer side
+    bool pop(TouchPoint& sample);
+    uint8_t pop(TouchPoint* out, uint8_t maxCount);
+    void clear();
+    
+    uint8_t size() const;
+    bool isEmpty() const;
+    uint32_t getDroppedCount() const;
+};
+
+typedef TouchSampleQueueT<16> TouchSampleQueue;
+
+#ifdef WATER_REJECTION_PROFILE
+// processTouch() stages timed by the profiling build
+enum ProfileStage {
+    PROFILE_DEBOUNCE,                    // Resistive pressure and debounce checks
+    PROFILE_GESTURE,                     // validateGesture()
+    PROFILE_WATER,                       // isWaterPattern()
+    PROFILE_STATIC,                      // isStaticTouch()
+    PROFILE_STREAK,                      // isStreakTouch()
+    PROFILE_UPDATE,                      // updateHistory() and updateZones()
+    PROFILE_STAGE_COUNT
+};
+
+// Counts are CPU cycles from DWT CYCCNT on Cortex-M3 and up, CCOUNT on
+// ESP32, and microseconds elsewhere
+struct StageProfile {
+    uint32_t calls;
+    uint32_t minCycles;
+    uint32_t avgCycles;
+    uint32_t maxCycles;
+};
+
+struct WaterRejectionProfile {
+    StageProfile stages[PROFILE_STAGE_COUNT];
+};
+#endif
+
+// Water rejection filter with compile-time sizes:
+//   GridW x GridH - zone grid used for spatial filtering
+//   History       - touch history length used for static touch detection
+//   MaxPoints     - simultaneous touches analysed by processMultiTouch()
+// Power-of-two sizes let the compiler use shifts and masks for indexing.
+template <uint8_t GridW, uint8_t GridH, uint8_t History, uint8_t MaxPoints>
+class WaterRejectionTouchT {
+private:
+    static_assert(GridW > 0 && GridH > 0, "Zone grid must not be empty");
+    static_assert(History > 0, "History must hold at least one touch");
+    static_assert(MaxPoints > 1, "MaxPoints must allow multi-touch analysis");
+    
     // Touch zones for spatial filtering
-    static const uint8_t ZONE_GRID_SIZE = 20;
+    static const uint8_t ZONE_GRID_WIDTH = GridW;
+    static const uint8_t ZONE_GRID_HEIGHT = GridH;
+    static const uint16_t ZONE_COUNT = (uint16_t)GridW * GridH;
+    
+    #ifdef WATER_REJECTION_COMPACT_ZONES
+    // Compact zone: timestamps are 16-bit ms relative to zoneEpoch (wrap-safe
+    // for ages below 65 s), touch count and generation tag live in packed arrays
+    static const uint8_t MAX_ZONE_TOUCH_COUNT = 15;   // touchCount saturates here
     
     struct TouchZone {
-        bool active;
-        uint32_t activationTime;
-        uint8_t touchCount;
-        uint32_t lastTouchTime;
+        uint16_t activationTime;
+        uint16_t lastTouchTime;
     };
+    #endif
+    
+    // Stored zone times are timebase ticks >> ZONE_TIME_SHIFT. Only the
+    // compact grid on the micros() timebase drops bits: 1.024 ms units keep
+    // its 65 s range.
+    #if defined(WATER_REJECTION_COMPACT_ZONES) && defined(WATER_REJECTION_MICROS_TIMEBASE)
+    static const uint8_t ZONE_TIME_SHIFT = 10;
+    #else
+    static const uint8_t ZONE_TIME_SHIFT = 0;
+    #endif
+    
+    // Zones expire lazily: one is live while its tag belongs to the current
+    // or previous generation and it has been idle no longer than touchTimeout.
+    // A generation spans half the range of the stored times, so the age of a
+    // tagged zone is always exact; tags cycle 1..3 (0 = never touched) and the
+    // oldest is retired from the grid as a new generation starts, once per
+    // span. touchTimeout must stay below the span (32 s with compact zones).
+    #ifdef WATER_REJECTION_COMPACT_ZONES
+    static const uint32_t ZONE_GENERATION_SPAN = 32768UL << ZONE_TIME_SHIFT;
+    #else
+    static const uint32_t ZONE_GENERATION_SPAN = 1UL << 30;
+    #endif
+    static const uint8_t ZONE_GENERATIONS = 3;
     
     // Touch history for temporal filtering
-    static const uint8_t HISTORY_SIZE = 20;
-    TouchPoint touchHistory[HISTORY_SIZE];
-    uint8_t historyIndex;
+    static const uint8_t HISTORY_SIZE = History;
+    TouchHistoryT<HISTORY_SIZE> touchHistory;
+    
+    // Zone grid (index = x * ZONE_GRID_HEIGHT + y)
+    #ifdef WATER_REJECTION_COMPACT_ZONES
+    TouchZone zones[ZONE_COUNT];
+    uint8_t zoneTouchCounts[(ZONE_COUNT + 1) / 2];   // Two saturating 4-bit counts per byte
+    uint8_t zoneTags[(ZONE_COUNT + 3) / 4];           // Four 2-bit generation tags per byte
+    uint32_t zoneEpoch;
+    #else
+    // One array per field - no struct padding, 10 bytes per zone instead of 16
+    // on 32-bit targets
+    uint32_t zoneActivationTimes[ZONE_COUNT];
+    uint32_t zoneLastTouchTimes[ZONE_COUNT];
+    uint8_t zoneTouchCounts[ZONE_COUNT];
+    uint8_t zoneTags[ZONE_COUNT];
+    #endif
+    uint8_t zoneGeneration;              // Tag stamped on zones touched now, 1..3
+    uint32_t generationStart;
     
-    // Zone grid
-    TouchZone zones[ZONE_GRID_SIZE][ZONE_GRID_SIZE];
+    // Coarse level over the grid: the newest touch in each region of a 5x5
+    // split, tagged like the zones, so spread across the whole panel costs
+    // 25 checks whatever the fine resolution
+    static const uint8_t REGION_GRID_SIZE = 5;
+    static const uint8_t REGION_COUNT = REGION_GRID_SIZE * REGION_GRID_SIZE;
+    uint32_t regionLastTouchTimes[REGION_COUNT];
+    uint8_t regionTags[REGION_COUNT];
+    
+    // Earliest time at which update() has work: the gesture timeout.
+    // Touches pull it earlier; update() recomputes it. Zones need no update().
+    uint32_t updateDeadline;
     
     // Screen dimensions
     uint16_t screenWidth;
     uint16_t screenHeight;
     
+    // Pixel to zone scale factors (Q24 reciprocals, rounded up so the result
+    // matches (x * GridW) / screenWidth exactly for screens up to 4096 px)
+    uint32_t zoneScaleX;
+    uint32_t zoneScaleY;
+    
+    struct ZoneCoord {
+        uint8_t x;
+        uint8_t y;
+        uint16_t index;
+    };
+    
     // Configuration
     WaterRejectionConfig config;
     
+    // Event detection for getTouchEvent()
+    TouchEventTracker touchEvents;
+    
     // Gesture state
     enum GestureState {
         GESTURE_IDLE,
@@ -108,17 +555,87 @@ private:
         GESTURE_ACTIVE
     };
     
+    // Longest unlock setGestureUnlock() takes (s) - within isBefore() range
+    // on the micros() timebase
+    static const uint16_t MAX_GESTURE_UNLOCK = 1800;
+    
     GestureState gestureState;
     uint32_t gestureStateTimeout;
     TouchPoint gestureStartPoint;
+    uint16_t gestureUnlockTimes[UNLOCK_GESTURE_COUNT];   // s, 0 = not an unlock gesture
+    UnlockGesture unlockedBy;
+    
+    // Matching is incremental: one bit per stroke gesture still possible from
+    // gestureStartPoint, dropped as soon as a sample rules it out
+    uint8_t gestureCandidates;
+    bool gestureCornerReached;           // L-shape on its second leg, from the corner
+    int16_t gestureCornerX;
+    int16_t gestureCornerY;
+    
+    // Two-finger hold, anchored where both fingers came to rest
+    bool holdTracking;
+    uint32_t holdStartTime;
+    int16_t holdCenterX;
+    int16_t holdCenterY;
+    uint16_t holdSpread;
     
     // Multi-touch tracking
+    static const uint8_t MAX_TOUCH_POINTS = MaxPoints;
     uint8_t currentTouchCount;
-    TouchPoint multiTouchPoints[5];
+    TouchPoint multiTouchPoints[MAX_TOUCH_POINTS];
+    
+    // Contacts followed across processMultiTouch() frames. Each finger keeps
+    // its own short history and debounce state so fingers cannot make each
+    // other look static; the zone grid stays shared because water spreads.
+    static const uint8_t CONTACT_HISTORY_SIZE = History < 8 ? History : 8;
+    
+    struct Contact {
+        TouchHistoryT<CONTACT_HISTORY_SIZE> history;
+        TouchPoint lastPosition;         // Last reported position, used for matching and staleness
+        TouchPoint lastValidTouch;
+        uint32_t lastValidTouchTime;
+        uint8_t id;                      // 0 = free slot
+    };
+    
+    Contact contacts[MAX_TOUCH_POINTS];
+    uint8_t nextContactId;
     
     // Statistics
     uint32_t waterDropletsRejected;
     uint32_t validTouches;
+    uint32_t rejectCounts[REJECT_REASON_COUNT];
+    #ifdef WATER_REJECTION_HISTOGRAMS
+    uint32_t areaHistogram[STATS_AREA_BINS];
+    uint32_t intervalHistogram[STATS_INTERVAL_BINS];
+    uint32_t lastSampleTime;
+    bool hasLastSample;
+    static uint8_t log2Bin(uint32_t value, uint8_t binCount);
+    #endif
+    
+    // Adaptive wet mode. Evidence is taken only from signals the tuned fields
+    // cannot influence - the neighbour spread, cluster and line rejections and
+    // the raw touch area - so tightening cannot feed itself.
+    static const uint8_t ADAPT_WINDOW = 16;          // Samples per evaluation
+    static const uint8_t ADAPT_DRY_RATE = 13;        // Q8 pattern reject rate (5%) for level 0
+    static const uint8_t ADAPT_WET_RATE = 64;        // Q8 pattern reject rate (25%) for level 255
+    static const uint8_t ADAPT_HYSTERESIS = 32;      // Level change needed to retune
+    
+    struct EnvironmentPreset {
+        uint16_t maxTouchArea;
+        uint16_t maxStaticTime;
+        uint8_t maxSimultaneousTouches;
+        bool requireGesture;
+        uint16_t pressureThreshold;
+        uint16_t streakWindow;
+    };
+    
+    bool adaptiveWetMode;
+    uint8_t wetnessLevel;                // Applied level, 0 = dry preset, 255 = wet preset
+    int32_t wetnessEvidence;             // Smoothed evidence, level in Q8
+    uint8_t adaptSamples;                // Samples in the current window
+    uint32_t adaptAreaSum;
+    uint32_t adaptPatternRejects;        // Pattern rejections before the current window
+    uint16_t userStreakWindow;           // streakWindow from begin()/setConfig(), the dry value
     
     // Screen type
     enum ScreenType {
@@ -131,20 +648,144 @@ private:
     uint32_t lastValidTouchTime;
     TouchPoint lastValidTouch;
     
+    #ifdef WATER_REJECTION_PROFILE
+    // Per-stage timing, recorded by a StageTimer scoped around each stage
+    StageProfile stageProfiles[PROFILE_STAGE_COUNT];
+    uint64_t stageTotals[PROFILE_STAGE_COUNT];
+    
+    class StageTimer {
+    private:
+        WaterRejectionTouchT* owner;
+        ProfileStage stage;
+        uint32_t start;
+    public:
+        StageTimer(WaterRejectionTouchT* filter, ProfileStage timedStage);
+        ~StageTimer();
+    };
+    
+    void recordStage(ProfileStage stage, uint32_t cycles);
+    #endif
+    
+    // State snapshot: memory images of the fields below, in this order
+    struct StateWriter {
+        uint8_t* out;
+        template <class T> void field(const T& value);
+    };
+    struct StateReader {
+        const uint8_t* in;
+        template <class T> void field(T& value);
+    };
+    static const uint8_t STATE_HEADER_SIZE = 14;
+    static const uint8_t STATE_CRC_SIZE = 4;
+    static const size_t STATE_PAYLOAD_SIZE =
+        sizeof(touchHistory) +
+        #ifdef WATER_REJECTION_COMPACT_ZONES
+        sizeof(zones) + sizeof(zoneTouchCounts) + sizeof(zoneTags) + sizeof(zoneEpoch) +
+        #else
+        sizeof(zoneActivationTimes) + sizeof(zoneLastTouchTimes) + sizeof(zoneTouchCounts) +
+        sizeof(zoneTags) +
+        #endif
+        sizeof(zoneGeneration) + sizeof(generationStart) +
+        sizeof(regionLastTouchTimes) + sizeof(regionTags) + sizeof(updateDeadline) +
+        sizeof(touchEvents) +
+        sizeof(gestureState) + sizeof(gestureStateTimeout) + sizeof(gestureStartPoint) +
+        sizeof(unlockedBy) + sizeof(gestureCandidates) + sizeof(gestureCornerReached) +
+        sizeof(gestureCornerX) + sizeof(gestureCornerY) +
+        sizeof(holdTracking) + sizeof(holdStartTime) + sizeof(holdCenterX) +
+        sizeof(holdCenterY) + sizeof(holdSpread) +
+        sizeof(currentTouchCount) + sizeof(multiTouchPoints) + sizeof(contacts) +
+        sizeof(nextContactId) +
+        sizeof(waterDropletsRejected) + sizeof(validTouches) + sizeof(rejectCounts) +
+        #ifdef WATER_REJECTION_HISTOGRAMS
+        sizeof(areaHistogram) + sizeof(intervalHistogram) + sizeof(lastSampleTime) +
+        sizeof(hasLastSample) +
+        #endif
+        sizeof(wetnessLevel) + sizeof(wetnessEvidence) + sizeof(adaptSamples) +
+        sizeof(adaptAreaSum) + sizeof(adaptPatternRejects) +
+        sizeof(lastValidTouchTime) + sizeof(lastValidTouch);
+    
+    template <class Self, class Stream>
+    static void transferState(Self& self, Stream& stream);
+    void rebaseState(uint32_t shift);
+    void writeStateHeader(uint8_t* header, uint32_t savedAt) const;
+    static uint32_t stateChecksum(const uint8_t* data, size_t length);
+    
     // Private methods
-    bool isWaterPattern(const TouchPoint& touch);
-    bool checkZoneActivity(uint8_t zoneX, uint8_t zoneY);
-    bool checkMultiTouchPattern();
-    bool isStaticTouch(const TouchPoint& touch);
-    void updateZones(const TouchPoint& touch);
-    void updateHistory(const TouchPoint& touch);
-    void clearOldZones();
+    bool processTouchAt(const TouchPoint& touch, uint32_t currentTime);
+    template <class HistoryT>
+    bool processTouchAt(const TouchPoint& touch, uint32_t currentTime, HistoryT& history,
+                        TouchPoint& lastValid, uint32_t& lastValidTime);
+    RejectReason precheckTouch(const TouchPoint& touch, TouchPoint& lastValid,
+                               uint32_t& lastValidTime, bool& held);
+    void trackContacts(TouchPoint* touches, uint8_t count, uint32_t currentTime, uint8_t* slots);
+    void releaseContact(Contact& contact);
+    bool isContactStale(const Contact& contact, uint32_t currentTime) const;
+    RejectReason isWaterPattern(const TouchPoint& touch, const ZoneCoord& zone, uint32_t currentTime);
+    RejectReason checkZoneActivity(uint8_t zoneX, uint8_t zoneY, uint32_t currentTime);
+    uint8_t countZoneBurst(uint16_t zoneIndex, uint32_t currentTime);
+    uint8_t countLiveNeighbors(uint8_t zoneX, uint8_t zoneY, uint32_t currentTime) const;
+    uint8_t scoreTouch(const TouchPoint& touch, const ZoneCoord& zone, uint32_t currentTime,
+                       RejectReason& strongest);
+    static uint8_t scoreFeature(uint32_t value, uint32_t limit);
+    RejectReason checkMultiTouchPattern();
+    template <class HistoryT>
+    bool isStaticTouch(const TouchPoint& touch, HistoryT& history);
+    template <class HistoryT>
+    bool isStreakTouch(const TouchPoint& touch, HistoryT& history);
+    void updateZones(const TouchPoint& touch, const ZoneCoord& zone);
+    void updateZoneScale();
+    ZoneCoord mapToZone(const TouchPoint& touch) const;
+    template <class HistoryT>
+    void updateHistory(const TouchPoint& touch, HistoryT& history);
+    void scheduleUpdate(uint32_t deadline);
+    static bool isBefore(uint32_t time, uint32_t deadline);
+    static uint16_t zoneIndexOf(uint8_t zoneX, uint8_t zoneY);
+    static uint8_t regionOf(uint16_t zoneIndex);
+    
+    // Zone storage accessors (plain or compact layout)
+    void clearZones();
+    uint8_t getZoneTag(uint16_t zoneIndex) const;
+    void setZoneTag(uint16_t zoneIndex, uint8_t tag);
+    uint8_t getZoneTouchCount(uint16_t zoneIndex) const;
+    void setZoneTouchCount(uint16_t zoneIndex, uint8_t count);
+    uint32_t getZoneActivationAge(uint16_t zoneIndex, uint32_t currentTime) const;
+    uint32_t getZoneIdleTime(uint16_t zoneIndex, uint32_t currentTime) const;
+    void stampZone(uint16_t zoneIndex, uint32_t timestamp);
+    
+    // Lazy expiry (either layout)
+    void advanceGeneration(uint32_t currentTime);
+    bool isCurrentTag(uint8_t tag) const;
+    bool isZoneLive(uint16_t zoneIndex, uint32_t currentTime) const;
+    bool isRegionLive(uint8_t region, uint32_t currentTime) const;
+    uint8_t countLiveRegions(uint32_t currentTime) const;
+    #ifdef WATER_REJECTION_FIXED_POINT
+    uint8_t getAnalysedTouchCount() const;
+    bool isTightCluster();
+    bool isLinePattern();
+    static uint32_t isqrt(uint32_t value);
+    static uint32_t isqrt64(uint64_t value);
+    #else
     float calculateTouchClusterDensity();
+    #endif
     bool validateGesture(const TouchPoint& touch);
+    void startGesture(const TouchPoint& touch);
+    UnlockGesture matchGesture(const TouchPoint& touch);
+    bool isAtSwipeStart(const TouchPoint& touch, uint8_t gesture) const;
+    void unlockGesture(UnlockGesture gesture, uint32_t currentTime);
+    void trackTwoFingerHold(const TouchPoint* touches, uint8_t count);
+    void clearGesture();
+    EnvironmentPreset getEnvironmentPreset(bool wetEnvironment) const;
+    void applyPreset(const EnvironmentPreset& preset);
+    void applyWetness(uint8_t level);
+    void observeTouches(const TouchPoint* touches, uint8_t count);
+    void adaptWetness();
+    uint32_t getPatternRejects() const;
+    static uint8_t ramp(uint32_t value, uint32_t low, uint32_t high);
+    static uint16_t blend(uint16_t dry, uint16_t wet, uint8_t level);
     
 public:
     // Constructor
-    WaterRejectionTouch(uint16_t width, uint16_t height);
+    WaterRejectionTouchT(uint16_t width, uint16_t height);
     
     // Initialization
     void begin();
@@ -155,11 +796,56 @@ public:
     bool processTouch(int16_t x, int16_t y, uint8_t pressure);
     bool processTouch(const TouchPoint& touch);
     
-    // Multi-touch processing
+    // Same, with the current time supplied by the caller instead of read from
+    // the clock - for ISR and batch paths that already hold it. now is in the
+    // timebase of waterRejectionNow() and must not be older than the touch.
+    bool processTouch(const TouchPoint& touch, uint32_t now);
+    
+    // Batch processing for buffered controller reports. Runs the same stages
+    // as processTouch() over the burst in order with a single clock read.
+    // verdicts (optional, count entries) receives 1 for accepted, 0 for rejected.
+    // Returns the number of accepted touches.
+    size_t processBatch(const TouchPoint* touches, size_t count, uint8_t* verdicts = nullptr);
+    size_t processBatch(const TouchPoint* touches, size_t count, uint8_t* verdicts, uint32_t now);
+    
+    // Water likelihood of a touch in Q8: 0 for a clean finger, 255 for water
+    // or a touch that cannot count (out of bounds, locked, flagged by the
+    // controller, debounced). All features are computed for every sample and
+    // mixed with config.scoreWeights, so the result is the same whatever the
+    // caller does with it. Touches scoring below config.scoreThreshold are
+    // tracked and counted as valid like an accepted processTouch(); compare
+    // the score with a stricter threshold of your own for critical controls.
+    uint8_t classifyTouch(const TouchPoint& touch);
+    uint8_t classifyTouch(const TouchPoint& touch, uint32_t now);
+    
+    // Consume everything queued by the producer. lastAccepted (optional)
+    // receives the newest accepted sample. Returns the number accepted.
+    template <uint8_t Capacity>
+    size_t drain(TouchSampleQueueT<Capacity>& queue, TouchPoint* lastAccepted = nullptr);
+    
+    // Multi-touch processing. Call once per controller frame, with count 0
+    // when nothing is touching; each touch's id is set to its contact ID.
+    // now is the frame's time as for processTouch(touch, now). verdicts
+    // (optional, count entries) receives 1 for each accepted touch, 0 for
+    // rejected ones. Returns true if any touch was accepted. A contact not
+    // reported for touchTimeout is released even if no count 0 frame came,
+    // and is no longer counted by getActiveContactCount().
     bool processMultiTouch(TouchPoint* touches, uint8_t count);
+    bool processMultiTouch(TouchPoint* touches, uint8_t count, uint32_t now,
+                           uint8_t* verdicts = nullptr);
+    uint8_t getActiveContactCount() const;
     
-    // Update function (call in loop)
-    void update();
+    // Coarse regions (of 25) that currently hold an active zone
+    uint8_t getActiveRegionCount() const;
+    
+    // Update function (call in loop). Returns immediately until the next
+    // deadline and returns it, or WATER_REJECTION_NO_DEADLINE when idle.
+    uint32_t update();
+    uint32_t update(uint32_t now);
+    
+    // Time (waterRejectionNow() timebase) at which update() next has work.
+    // Sleep until this or the next touch interrupt, whichever comes first.
+    uint32_t nextDeadline() const;
     
     // Configuration
     void setConfig(const WaterRejectionConfig& newConfig);
@@ -174,22 +860,80 @@ public:
     bool isGestureActive() const;
     void resetGesture();
     
+    // Unlock gestures: seconds the gesture unlocks for (at most 1800),
+    // 0 to stop it unlocking. Stroke gestures are matched point by point
+    // in enum order, so a stroke that could be two gestures is the first.
+    void setGestureUnlock(UnlockGesture gesture, uint16_t seconds);
+    uint16_t getGestureUnlock(UnlockGesture gesture) const;
+    
+    // Gesture behind the current unlock, UNLOCK_NONE while locked
+    UnlockGesture getUnlockGesture() const;
+    
     // Statistics
     uint32_t getWaterDropletsRejected() const;
     uint32_t getValidTouches() const;
+    uint32_t getRejectCount(RejectReason reason) const;
     void resetStatistics();
     
+    // Copy of all counters - no allocation, no Serial
+    WaterRejectionStats getStatsSnapshot() const;
+    
+    // Little-endian binary export for telemetry: version byte, reason count,
+    // then every WaterRejectionStats counter as uint32 in declaration order.
+    // Returns bytes written, or 0 if length is below STATS_EXPORT_SIZE.
+    static const uint8_t STATS_EXPORT_VERSION = 1;
+    static const size_t STATS_EXPORT_SIZE = 2 + sizeof(WaterRejectionStats);
+    size_t serializeStats(uint8_t* buffer, size_t length) const;
+    
+    // Warm boot: history, zones, contacts, gesture unlock, statistics and the
+    // adaptive wet calibration as one versioned block, to keep in RTC memory
+    // or NVS across deep sleep or a watchdog reset. Configuration is not in
+    // it - begin() with yours, then restoreState(). The block is a memory
+    // image for this build: its sizes and options are checked, and a CRC-32
+    // covers the whole of it.
+    static const uint8_t STATE_SNAPSHOT_VERSION = 1;
+    static const size_t STATE_SNAPSHOT_SIZE = STATE_HEADER_SIZE + STATE_PAYLOAD_SIZE + STATE_CRC_SIZE;
+    
+    // Returns bytes written, or 0 if length is below STATE_SNAPSHOT_SIZE
+    size_t saveState(uint8_t* buffer, size_t length) const;
+    
+    // elapsed is the time (ms) since saveState() that the clock did not see,
+    // e.g. the deep sleep duration; every stored time is moved onto the
+    // current clock so ages carry on from the snapshot plus elapsed. Returns
+    // false, leaving the filter untouched, for a corrupt block or one from
+    // another build or version.
+    bool restoreState(const uint8_t* buffer, size_t length, uint32_t elapsed = 0);
+    
+    #ifdef WATER_REJECTION_PROFILE
+    // Profiling (WATER_REJECTION_PROFILE builds only)
+    WaterRejectionProfile getProfile() const;
+    void resetProfile();
+    #endif
+    
+    #ifndef WATER_REJECTION_NO_DEBUG
     // Debugging
     void printDebugInfo();
     void printZoneMap();
+    #endif
     
     // Touch event detection
     TouchEvent getTouchEvent(const TouchPoint& current);
     
-    // Calibration helpers
+    // Calibration helpers. Both switch adaptive wet mode off. Dry restores the
+    // streakWindow from begin()/setConfig(), wet raises it to at least 1500 ms.
     void calibrateForEnvironment(bool wetEnvironment);
     void setWetModeEnabled(bool enabled);
     
+    // Adaptive wet mode: moves maxTouchArea, maxStaticTime,
+    // maxSimultaneousTouches and streakWindow between the dry and wet presets
+    // as conditions change, so those fields are owned by the filter while on.
+    // The dry end of streakWindow is the value from begin()/setConfig(), so a
+    // window set there is never switched off.
+    // The level (0 = dry, 255 = wet) is re-evaluated every 16 samples.
+    void setAdaptiveWetMode(bool enabled);
+    bool isAdaptiveWetMode() const;
+    uint8_t getWetnessLevel() const;
+    
     // Screen type helpers
     const char* getScreenTypeName() const;
     bool isResistiveScreen() const;
@@ -197,12 +941,57 @@ public:
     void optimizeForScreenType();
 };
 
-// Helper class for touch event handling
-class TouchEventHandler {
-private:
-    WaterRejectionTouch* waterFilter;
+#include "WaterRejectionTouchImpl.h"
+
+// Default filter: 20x20 zone grid, 20 touch history, 5 touch points
+typedef WaterRejectionTouchT<20, 20, 20, 5> WaterRejectionTouch;
+extern template class WaterRejectionTouchT<20, 20, 20, 5>;
+
+// Start/move/end dispatch with the handler bound at compile time, so the
+// calls inline. Derived provides
+//   void onTouchEvent(TouchEvent event, const TouchPoint& touch);
+// and may provide onBatchComplete(size_t accepted), called once at the end
+// of every handleBatch() after all of its events. touch refers to the
+// caller's sample (the last accepted one for a release) - it is not copied.
+template <class Derived, class Filter = WaterRejectionTouch>
+class TouchEventDispatcherT {
+protected:
+    static const uint32_t RELEASE_TIMEOUT = 100;  // ms without an accepted touch
+    
+    Filter* waterFilter;
     TouchPoint lastTouch;
     TouchEvent lastEvent;
+    TouchEventTracker events;
+    
+    void dispatch(const TouchPoint& touch, uint16_t minMovement);
+    
+public:
+    explicit TouchEventDispatcherT(Filter* filter);
+    
+    // Filter one sample and dispatch its event. Returns true if accepted.
+    bool handleTouch(const TouchPoint& touch);
+    
+    // Filter a burst with one processBatch() pass per chunk and dispatch the
+    // accepted touches in order. Returns accepted count.
+    size_t handleBatch(const TouchPoint* touches, size_t count);
+    
+    // Runs the filter update and release detection. Returns the earlier of
+    // the filter deadline and the pending release, like the filter's update().
+    uint32_t update();
+    
+    // Default hooks - hidden by Derived
+    void onTouchEvent(TouchEvent, const TouchPoint&) {}
+    void onBatchComplete(size_t) {}
+};
+
+// Callback with a user context and the full touch
+typedef void (*TouchEventCallback)(void* context, TouchEvent event, const TouchPoint& touch);
+
+// Helper class for touch event handling
+class TouchEventHandler : public TouchEventDispatcherT<TouchEventHandler> {
+private:
+    TouchEventCallback onEvent;
+    void* eventContext;
     
     void (*onTouchStart)(int16_t x, int16_t y);
     void (*onTouchMove)(int16_t x, int16_t y);
@@ -211,12 +1000,94 @@ private:
 public:
     TouchEventHandler(WaterRejectionTouch* filter);
     
+    // Receives every event with its TouchPoint; context is passed back as is
+    void setEventCallback(TouchEventCallback callback, void* context);
+    
     void setTouchStartCallback(void (*callback)(int16_t, int16_t));
     void setTouchMoveCallback(void (*callback)(int16_t, int16_t));
     void setTouchEndCallback(void (*callback)(int16_t, int16_t));
     
+    using TouchEventDispatcherT<TouchEventHandler>::handleTouch;
     void handleTouch(int16_t x, int16_t y);
-    void update();
+    
+    void onTouchEvent(TouchEvent event, const TouchPoint& touch);
 };
 
+// TouchEventDispatcherT implementation
+template <class Derived, class Filter>
+TouchEventDispatcherT<Derived, Filter>::TouchEventDispatcherT(Filter* filter)
+    : waterFilter(filter), lastTouch(), lastEvent(TOUCH_NONE) {
+}
+
+template <class Derived, class Filter>
+bool TouchEventDispatcherT<Derived, Filter>::handleTouch(const TouchPoint& touch) {
+    if (!waterFilter->processTouch(touch)) {
+        return false;
+    }
+    dispatch(touch, waterFilter->getConfig().minMovement);
+    return true;
+}
+
+template <class Derived, class Filter>
+size_t TouchEventDispatcherT<Derived, Filter>::handleBatch(const TouchPoint* touches, size_t count) {
+    const uint8_t CHUNK_SIZE = 8;
+    uint8_t verdicts[CHUNK_SIZE];
+    uint16_t minMovement = waterFilter->getConfig().minMovement;
+    size_t accepted = 0;
+    
+    for (size_t start = 0; start < count; start += CHUNK_SIZE) {
+        size_t chunk = count - start < CHUNK_SIZE ? count - start : CHUNK_SIZE;
+        accepted += waterFilter->processBatch(touches + start, chunk, verdicts);
+        
+        for (size_t i = 0; i < chunk; i++) {
+            if (verdicts[i]) {
+                dispatch(touches[start + i], minMovement);
+            }
+        }
+    }
+    
+    static_cast<Derived*>(this)->onBatchComplete(accepted);
+    return accepted;
+}
+
+template <class Derived, class Filter>
+void TouchEventDispatcherT<Derived, Filter>::dispatch(const TouchPoint& touch, uint16_t minMovement) {
+    TouchEvent event = events.update(touch, minMovement);
+    
+    if (event == TOUCH_START || event == TOUCH_MOVE || event == TOUCH_END) {
+        static_cast<Derived*>(this)->onTouchEvent(event, touch);
+    }
+    
+    lastEvent = event;
+    lastTouch = touch;
+}
+
+template <class Derived, class Filter>
+uint32_t TouchEventDispatcherT<Derived, Filter>::update() {
+    uint32_t deadline = waterFilter->update();
+    
+    // Check for touch release
+    if (lastTouch.valid &&
+        waterRejectionNow() - lastTouch.timestamp > waterRejectionTicks(RELEASE_TIMEOUT)) {
+        lastTouch.valid = false;
+        lastEvent = TOUCH_END;
+        events.reset();  // The next accepted touch starts a new press
+        static_cast<Derived*>(this)->onTouchEvent(TOUCH_END, lastTouch);
+    }
+    
+    // A pending release is a deadline too
+    if (lastTouch.valid) {
+        uint32_t release = lastTouch.timestamp + waterRejectionTicks(RELEASE_TIMEOUT) + 1;
+        if (deadline == WATER_REJECTION_NO_DEADLINE || (int32_t)(release - deadline) < 0) {
+            deadline = release;
+        }
+    }
+    
+    return deadline;
+}
+
+extern template class TouchEventDispatcherT<TouchEventHandler>;
+
+} // inline namespace WRT_ABI_NAMESPACE
+
 #endif // WATER_REJECTION_TOUCH_H
\ No newline at end of file
@@ -0,0 +1,2762 @@
+/**
+ * WaterRejectionTouchImpl.h
+ * Template implementation of WaterRejectionTouchT - included by WaterRejectionTouch.h
+ * 
+ * Author: Assistant
+ * License: MIT
+ */
+
+#ifndef WATER_REJECTION_TOUCH_IMPL_H
+#define WATER_REJECTION_TOUCH_IMPL_H
+
+// TouchHistoryT implementation
+template <uint8_t N>
+TouchHistoryT<N>::TouchHistoryT() {
+    clear();
+}
+
+template <uint8_t N>
+void TouchHistoryT<N>::clear() {
+    for (uint8_t i = 0; i < N; i++) {
+        store(i, TouchPoint());
+    }
+    memset(slotDistance, FAR_ENTRY, sizeof(slotDistance));
+    memset(distanceCounts, 0, sizeof(distanceCounts));
+    head = 0;
+    count = 0;
+    windowStart = 0;
+    windowCount = 0;
+    windowTime = 0;
+    anchorX = 0;
+    anchorY = 0;
+    anchorMovement = 0;
+    anchorValid = false;
+    streakTime = 0;
+    resetStreak();
+}
+
+// Durations and the streak sums are relative, only the entries move
+template <uint8_t N>
+void TouchHistoryT<N>::rebase(uint32_t shift) {
+    for (uint8_t i = 0; i < N; i++) {
+        #ifdef WATER_REJECTION_SOA_HISTORY
+        entryTimes[i] += shift;
+        #else
+        entries[i].timestamp += shift;
+        #endif
+    }
+}
+
+#ifdef WATER_REJECTION_SOA_HISTORY
+template <uint8_t N>
+int16_t TouchHistoryT<N>::xAt(uint8_t index) const {
+    return entryX[index];
+}
+
+template <uint8_t N>
+int16_t TouchHistoryT<N>::yAt(uint8_t index) const {
+    return entryY[index];
+}
+
+template <uint8_t N>
+uint32_t TouchHistoryT<N>::timeAt(uint8_t index) const {
+    return entryTimes[index];
+}
+
+template <uint8_t N>
+bool TouchHistoryT<N>::validAt(uint8_t index) const {
+    return entryValid[index >> 3] & (1 << (index & 7));
+}
+
+// Only what the history checks read is kept
+template <uint8_t N>
+void TouchHistoryT<N>::store(uint8_t index, const TouchPoint& touch) {
+    entryTimes[index] = touch.timestamp;
+    entryX[index] = touch.x;
+    entryY[index] = touch.y;
+    if (touch.valid) {
+        entryValid[index >> 3] |= 1 << (index & 7);
+    } else {
+        entryValid[index >> 3] &= ~(1 << (index & 7));
+    }
+}
+#else
+template <uint8_t N>
+int16_t TouchHistoryT<N>::xAt(uint8_t index) const {
+    return entries[index].x;
+}
+
+template <uint8_t N>
+int16_t TouchHistoryT<N>::yAt(uint8_t index) const {
+    return entries[index].y;
+}
+
+template <uint8_t N>
+uint32_t TouchHistoryT<N>::timeAt(uint8_t index) const {
+    return entries[index].timestamp;
+}
+
+template <uint8_t N>
+bool TouchHistoryT<N>::validAt(uint8_t index) const {
+    return entries[index].valid;
+}
+
+template <uint8_t N>
+void TouchHistoryT<N>::store(uint8_t index, const TouchPoint& touch) {
+    entries[index] = touch;
+}
+#endif
+
+// Advance a slot - a mask when N is a power of two
+template <uint8_t N>
+uint8_t TouchHistoryT<N>::next(uint8_t index) {
+    if ((N & (N - 1)) == 0) {
+        return (index + 1) & (N - 1);
+    }
+    return (index + 1) % N;
+}
+
+template <uint8_t N>
+uint32_t TouchHistoryT<N>::distanceFromAnchor(int16_t x, int16_t y) const {
+    uint32_t dx = abs((int32_t)x - anchorX);
+    uint32_t dy = abs((int32_t)y - anchorY);
+    return dx > dy ? dx : dy;
+}
+
+template <uint8_t N>
+void TouchHistoryT<N>::addToAnchor(uint8_t index) {
+    uint8_t distance = FAR_ENTRY;
+    if (validAt(index)) {
+        uint32_t d = distanceFromAnchor(xAt(index), yAt(index));
+        if (d < 2UL * anchorMovement) {
+            distance = d;
+            distanceCounts[distance]++;
+        }
+    }
+    slotDistance[index] = distance;
+}
+
+template <uint8_t N>
+void TouchHistoryT<N>::removeFromAnchor(uint8_t index) {
+    if (slotDistance[index] != FAR_ENTRY) {
+        distanceCounts[slotDistance[index]]--;
+        slotDistance[index] = FAR_ENTRY;
+    }
+}
+
+// Re-anchor on a touch and rebuild the distance histogram of the window
+template <uint8_t N>
+void TouchHistoryT<N>::setAnchor(const TouchPoint& touch, uint16_t minMovement) {
+    anchorX = touch.x;
+    anchorY = touch.y;
+    anchorMovement = minMovement;
+    anchorValid = true;
+    memset(distanceCounts, 0, sizeof(distanceCounts));
+    
+    uint8_t index = windowStart;
+    for (uint8_t i = 0; i < windowCount; i++) {
+        addToAnchor(index);
+        index = next(index);
+    }
+}
+
+// Remove the oldest entry from the static window
+template <uint8_t N>
+void TouchHistoryT<N>::dropOldest() {
+    if (anchorValid) {
+        removeFromAnchor(windowStart);
+    }
+    windowStart = next(windowStart);
+    windowCount--;
+}
+
+#ifdef WATER_REJECTION_SOA_HISTORY
+// Exact check over the window, stopping as soon as the answer is known. The
+// window is at most two contiguous runs of the ring.
+template <uint8_t N>
+bool TouchHistoryT<N>::scanStatic(const TouchPoint& touch, uint16_t minMovement,
+                                  uint32_t maxStaticTime, uint8_t maxStaticCount) const {
+    uint8_t needed = maxStaticCount + 1;
+    uint16_t end = windowStart + windowCount;
+    uint8_t found = scanRun(windowStart, end < N ? end : N, touch, minMovement,
+                            maxStaticTime, needed);
+    if (found < needed && end > N) {
+        found += scanRun(0, end - N, touch, minMovement, maxStaticTime, needed - found);
+    }
+    return found >= needed;
+}
+
+// Lanes of two packed int16 entries within limit of the touch on one axis:
+// 0xFFFF for each lane where |entry - touch| < limit, 0 elsewhere. Screen
+// coordinates keep the differences inside int16.
+template <uint8_t N>
+uint32_t TouchHistoryT<N>::nearPair(uint32_t packed, uint32_t touch, uint32_t limit) {
+    #if defined(__ARM_FEATURE_SIMD32)
+    uint32_t distance;
+    uint32_t negated;
+    __asm__ ("ssub16 %1, %3, %2\n\t"      // touch - entry
+             "ssub16 %0, %2, %3\n\t"      // entry - touch, GE where >= 0
+             "sel %0, %0, %1\n\t"         // |entry - touch|
+             "ssub16 %1, %0, %4\n\t"      // GE where outside the limit
+             "sel %0, %5, %6"
+             : "=&r"(distance), "=&r"(negated)
+             : "r"(packed), "r"(touch), "r"(limit), "r"(0UL), "r"(0xFFFFFFFFUL)
+             : "cc");
+    return distance;
+    #else
+    uint32_t mask = 0;
+    for (uint8_t lane = 0; lane < 32; lane += 16) {
+        int32_t d = (int32_t)(int16_t)(packed >> lane) - (int16_t)(touch >> lane);
+        if ((uint32_t)abs(d) < (limit & 0xFFFF)) {
+            mask |= 0xFFFFUL << lane;
+        }
+    }
+    return mask;
+    #endif
+}
+
+template <uint8_t N>
+bool TouchHistoryT<N>::isStaticEntry(uint8_t index, uint32_t timestamp,
+                                     uint32_t maxStaticTime) const {
+    return validAt(index) && timestamp - entryTimes[index] < maxStaticTime;
+}
+
+// Static entries in slots [from, to), counted up to needed. Pairs start on
+// even slots and are read as one 32-bit word from each of entryX and entryY.
+template <uint8_t N>
+uint8_t TouchHistoryT<N>::scanRun(uint8_t from, uint8_t to, const TouchPoint& touch,
+                                  uint16_t minMovement, uint32_t maxStaticTime,
+                                  uint8_t needed) const {
+    uint32_t limit = minMovement < 0x7FFF ? minMovement : 0x7FFF;
+    limit |= limit << 16;
+    uint32_t touchX = (uint16_t)touch.x * 0x10001UL;
+    uint32_t touchY = (uint16_t)touch.y * 0x10001UL;
+    uint8_t found = 0;
+    uint8_t index = from;
+    
+    while (index < to && found < needed) {
+        uint32_t near;
+        uint8_t lanes;
+        if ((index & 1) || index + 1 == to) {
+            // Odd slot or a lone last slot - shift it into the low lane
+            near = nearPair((uint16_t)entryX[index], touchX, limit) &
+                   nearPair((uint16_t)entryY[index], touchY, limit) & 0xFFFF;
+            lanes = 1;
+        } else {
+            uint32_t xs;
+            uint32_t ys;
+            memcpy(&xs, &entryX[index], sizeof(xs));
+            memcpy(&ys, &entryY[index], sizeof(ys));
+            near = nearPair(xs, touchX, limit) & nearPair(ys, touchY, limit);
+            lanes = 2;
+        }
+        
+        if ((near & 0xFFFF) && isStaticEntry(index, touch.timestamp, maxStaticTime)) {
+            found++;
+        }
+        if ((near >> 16) && found < needed &&
+            isStaticEntry(index + 1, touch.timestamp, maxStaticTime)) {
+            found++;
+        }
+        index += lanes;
+    }
+    return found;
+}
+#else
+// Exact check over the window, stopping as soon as the answer is known
+template <uint8_t N>
+bool TouchHistoryT<N>::scanStatic(const TouchPoint& touch, uint16_t minMovement,
+                                  uint32_t maxStaticTime, uint8_t maxStaticCount) const {
+    uint8_t staticCount = 0;
+    uint8_t index = windowStart;
+    
+    for (uint8_t i = 0; i < windowCount; i++) {
+        const TouchPoint& entry = entries[index];
+        if (entry.valid && touch.timestamp - entry.timestamp < maxStaticTime &&
+            abs((int32_t)entry.x - touch.x) < minMovement &&
+            abs((int32_t)entry.y - touch.y) < minMovement) {
+            if (++staticCount > maxStaticCount) {
+                return true;
+            }
+        }
+        index = next(index);
+    }
+    return false;
+}
+#endif
+
+template <uint8_t N>
+void TouchHistoryT<N>::push(const TouchPoint& touch) {
+    if (count == N) {
+        // Overwriting the oldest slot - it leaves the windows if still in them
+        if (windowCount == N) {
+            dropOldest();
+        }
+        if (streakCount == N) {
+            dropStreakOldest();
+        }
+    } else {
+        count++;
+    }
+    
+    if (windowCount == 0) {
+        windowStart = head;
+    }
+    store(head, touch);
+    windowCount++;
+    
+    if (anchorValid) {
+        addToAnchor(head);
+    } else {
+        slotDistance[head] = FAR_ENTRY;
+    }
+    
+    if (streakTime > 0) {
+        addToStreak(head);
+    }
+    
+    head = next(head);
+}
+
+template <uint8_t N>
+bool TouchHistoryT<N>::isStatic(const TouchPoint& touch, uint16_t minMovement,
+                                uint32_t maxStaticTime, uint8_t maxStaticCount) {
+    uint32_t currentTime = touch.timestamp;
+    
+    // A longer static time brings trimmed entries back - restart the window
+    if (maxStaticTime > windowTime) {
+        windowStart = (head + N - count) % N;
+        windowCount = count;
+        anchorValid = false;
+    }
+    windowTime = maxStaticTime;
+    
+    // Expire entries that aged past maxStaticTime
+    while (windowCount > 0 &&
+           currentTime - timeAt(windowStart) >= maxStaticTime) {
+        dropOldest();
+    }
+    
+    if (windowCount <= maxStaticCount || minMovement == 0) {
+        return false;
+    }
+    if (minMovement > MAX_TRACKED_MOVEMENT) {
+        anchorValid = false;
+        return scanStatic(touch, minMovement, maxStaticTime, maxStaticCount);
+    }
+    
+    // Re-anchor when the touch leaves the anchor box
+    if (!anchorValid || minMovement != anchorMovement ||
+        distanceFromAnchor(touch.x, touch.y) >= minMovement) {
+        setAnchor(touch, minMovement);
+    }
+    
+    // Entries nearer the anchor than (minMovement - offset) are inside the
+    // touch's box, entries at (minMovement + offset) or more are outside it
+    uint8_t offset = distanceFromAnchor(touch.x, touch.y);
+    uint8_t inside = 0;
+    uint8_t k = 0;
+    for (; k < minMovement - offset; k++) {
+        inside += distanceCounts[k];
+    }
+    if (inside > maxStaticCount) {
+        return true;
+    }
+    
+    uint8_t possible = inside;
+    for (; k < minMovement + offset; k++) {
+        possible += distanceCounts[k];
+    }
+    if (possible <= maxStaticCount) {
+        return false;
+    }
+    
+    return scanStatic(touch, minMovement, maxStaticTime, maxStaticCount);
+}
+
+template <uint8_t N>
+uint8_t TouchHistoryT<N>::previous(uint8_t index) {
+    return index == 0 ? N - 1 : index - 1;
+}
+
+// Chebyshev length of one step along the streak
+template <uint8_t N>
+uint32_t TouchHistoryT<N>::stepLength(int16_t fromX, int16_t fromY, int16_t toX, int16_t toY) {
+    uint32_t dx = abs((int32_t)toX - fromX);
+    uint32_t dy = abs((int32_t)toY - fromY);
+    return dx > dy ? dx : dy;
+}
+
+template <uint8_t N>
+void TouchHistoryT<N>::resetStreak() {
+    streakStart = head;
+    streakCount = 0;
+    streakOriginX = 0;
+    streakOriginY = 0;
+    streakSumX = 0;
+    streakSumY = 0;
+    streakSumXX = 0;
+    streakSumYY = 0;
+    streakSumXY = 0;
+    streakPath = 0;
+}
+
+// Append the entry at index, which must follow the current newest entry
+template <uint8_t N>
+void TouchHistoryT<N>::addToStreak(uint8_t index) {
+    int16_t newX = xAt(index);
+    int16_t newY = yAt(index);
+    if (streakCount == 0) {
+        streakStart = index;
+        streakOriginX = newX;
+        streakOriginY = newY;
+    } else {
+        streakPath += stepLength(xAt(previous(index)), yAt(previous(index)), newX, newY);
+    }
+    
+    int32_t x = (int32_t)newX - streakOriginX;
+    int32_t y = (int32_t)newY - streakOriginY;
+    streakSumX += x;
+    streakSumY += y;
+    streakSumXX += x * x;
+    streakSumYY += y * y;
+    streakSumXY += x * y;
+    streakCount++;
+}
+
+// Remove the oldest entry - it is the origin, so it adds nothing to the sums -
+// then move the origin to the new oldest entry
+template <uint8_t N>
+void TouchHistoryT<N>::dropStreakOldest() {
+    uint8_t oldest = streakStart;
+    streakStart = next(streakStart);
+    streakCount--;
+    if (streakCount == 0) {
+        resetStreak();
+        return;
+    }
+    
+    int16_t originX = xAt(streakStart);
+    int16_t originY = yAt(streakStart);
+    streakPath -= stepLength(xAt(oldest), yAt(oldest), originX, originY);
+    
+    // Shift every term by (a, b) in O(1), using the sums before the shift
+    int32_t n = streakCount;
+    int32_t a = (int32_t)originX - streakOriginX;
+    int32_t b = (int32_t)originY - streakOriginY;
+    streakSumXX += n * a * a - 2 * a * streakSumX;
+    streakSumYY += n * b * b - 2 * b * streakSumY;
+    streakSumXY += n * a * b - b * streakSumX - a * streakSumY;
+    streakSumX -= n * a;
+    streakSumY -= n * b;
+    streakOriginX = originX;
+    streakOriginY = originY;
+}
+
+// Rebuild the sums from the whole ring - only when the window grows
+template <uint8_t N>
+void TouchHistoryT<N>::rebuildStreak() {
+    resetStreak();
+    uint8_t index = (head + N - count) % N;
+    for (uint8_t i = 0; i < count; i++) {
+        addToStreak(index);
+        index = next(index);
+    }
+}
+
+template <uint8_t N>
+bool TouchHistoryT<N>::isStreak(const TouchPoint& touch, const StreakLimits& limits) {
+    if (limits.window == 0) {
+        if (streakTime > 0) {
+            streakTime = 0;
+            resetStreak();
+        }
+        return false;
+    }
+    
+    // A longer window brings trimmed entries back
+    if (limits.window > streakTime) {
+        rebuildStreak();
+    }
+    streakTime = limits.window;
+    
+    while (streakCount > 0 &&
+           touch.timestamp - timeAt(streakStart) >= limits.window) {
+        dropStreakOldest();
+    }
+    
+    // Enough samples spread over at least half the window to judge speed
+    uint8_t n = streakCount + 1;
+    if (streakCount == 0 || n < limits.minSamples) {
+        return false;
+    }
+    uint32_t duration = touch.timestamp - timeAt(streakStart);
+    if (duration < limits.window / 2u) {
+        return false;
+    }
+    duration /= WATER_REJECTION_TICKS_PER_MS;    // Speeds are per ms below
+    
+    // Net drift since the oldest entry, along and across the expected direction
+    int32_t x = (int32_t)touch.x - streakOriginX;
+    int32_t y = (int32_t)touch.y - streakOriginY;
+    int32_t along;
+    int32_t across;
+    switch (limits.direction) {
+        case STREAK_DOWN: along = y; across = abs(x); break;
+        case STREAK_UP: along = -y; across = abs(x); break;
+        case STREAK_RIGHT: along = x; across = abs(y); break;
+        case STREAK_LEFT: along = -x; across = abs(y); break;
+        default:
+            along = abs(x) > abs(y) ? abs(x) : abs(y);
+            across = abs(x) > abs(y) ? abs(y) : abs(x);
+            break;
+    }
+    if (along <= 0 || (limits.direction != STREAK_ANY && across * 2 > along)) {
+        return false;
+    }
+    
+    // Speed between the limits (px/s)
+    if ((uint32_t)along * 1000 < (uint32_t)limits.minSpeed * duration ||
+        (uint32_t)along * 1000 > (uint32_t)limits.maxSpeed * duration) {
+        return false;
+    }
+    
+    // Monotonic: the path walked is no more than 5/4 of the net drift
+    uint32_t path = streakPath +
+        stepLength(xAt(previous(head)), yAt(previous(head)), touch.x, touch.y);
+    if (path * 4 > (uint32_t)along * 5) {
+        return false;
+    }
+    
+    // Straight: the minor axis of the point cloud is at most a quarter of
+    // the major one (eigenvalue ratio 1/16, i.e. det * 289 <= trace^2 * 16)
+    int64_t sumX = streakSumX + x;
+    int64_t sumY = streakSumY + y;
+    int64_t sxx = (int64_t)n * (streakSumXX + x * x) - sumX * sumX;
+    int64_t syy = (int64_t)n * (streakSumYY + y * y) - sumY * sumY;
+    int64_t sxy = (int64_t)n * (streakSumXY + x * y) - sumX * sumY;
+    int64_t trace = sxx + syy;
+    if (trace == 0) {
+        return false;
+    }
+    // Scale down so the products below cannot overflow
+    while (trace > 0x0FFFFFFF || sxy > 0x0FFFFFFF || sxy < -0x0FFFFFFF) {
+        sxx >>= 2;
+        syy >>= 2;
+        sxy /= 4;
+        trace >>= 2;
+    }
+    int64_t det = sxx * syy - sxy * sxy;
+    return det * 289 <= trace * trace * 16;
+}
+
+// TouchSampleQueueT implementation
+template <uint8_t Capacity>
+TouchSampleQueueT<Capacity>::TouchSampleQueueT() 
+    : samples(), head(0), tail(0), droppedSamples(0) {
+}
+
+template <uint8_t Capacity>
+bool TouchSampleQueueT<Capacity>::push(const TouchPoint& sample) {
+    uint8_t currentHead = head;
+    uint8_t currentTail = __atomic_load_n(&tail, __ATOMIC_ACQUIRE);
+    
+    if ((uint8_t)(currentHead - currentTail) >= Capacity) {
+        droppedSamples++;
+        return false;  // Full - the consumer has fallen behind
+    }
+    
+    samples[currentHead & (Capacity - 1)] = sample;
+    __atomic_store_n(&head, (uint8_t)(currentHead + 1), __ATOMIC_RELEASE);
+    return true;
+}
+
+template <uint8_t Capacity>
+bool TouchSampleQueueT<Capacity>::pop(TouchPoint& sample) {
+    return pop(&sample, 1) == 1;
+}
+
+template <uint8_t Capacity>
+uint8_t TouchSampleQueueT<Capacity>::pop(TouchPoint* out, uint8_t maxCount) {
+    uint8_t currentTail = tail;
+    uint8_t available = __atomic_load_n(&head, __ATOMIC_ACQUIRE) - currentTail;
+    uint8_t count = available < maxCount ? available : maxCount;
+    
+    for (uint8_t i = 0; i < count; i++) {
+        out[i] = samples[(uint8_t)(currentTail + i) & (Capacity - 1)];
+    }
+    __atomic_store_n(&tail, (uint8_t)(currentTail + count), __ATOMIC_RELEASE);
+    return count;
+}
+
+template <uint8_t Capacity>
+void TouchSampleQueueT<Capacity>::clear() {
+    __atomic_store_n(&tail, __atomic_load_n(&head, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
+}
+
+template <uint8_t Capacity>
+uint8_t TouchSampleQueueT<Capacity>::size() const {
+    return (uint8_t)(__atomic_load_n(&head, __ATOMIC_ACQUIRE) -
+                     __atomic_load_n(&tail, __ATOMIC_ACQUIRE));
+}
+
+template <uint8_t Capacity>
+bool TouchSampleQueueT<Capacity>::isEmpty() const {
+    return size() == 0;
+}
+
+template <uint8_t Capacity>
+uint32_t TouchSampleQueueT<Capacity>::getDroppedCount() const {
+    return droppedSamples;
+}
+
+#ifdef WATER_REJECTION_PROFILE
+// Cycle counter used by the profiling build
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__) || defined(__ARM_ARCH_8M_MAIN__)
+inline void wrtStartCycleCounter() {
+    volatile uint32_t* demcr = (volatile uint32_t*)0xE000EDFC;
+    volatile uint32_t* dwtCtrl = (volatile uint32_t*)0xE0001000;
+    *demcr |= 1UL << 24;   // TRCENA - power up the DWT unit
+    *dwtCtrl |= 1UL;       // CYCCNTENA
+}
+
+inline uint32_t wrtCycleCount() {
+    return *(volatile uint32_t*)0xE0001004;   // DWT_CYCCNT
+}
+#elif defined(ESP32)
+inline void wrtStartCycleCounter() {}
+
+inline uint32_t wrtCycleCount() {
+    return ESP.getCycleCount();
+}
+#else
+inline void wrtStartCycleCounter() {}
+
+inline uint32_t wrtCycleCount() {
+    return micros();
+}
+#endif
+#endif
+
+#define WRT_TEMPLATE template <uint8_t GridW, uint8_t GridH, uint8_t History, uint8_t MaxPoints>
+#define WRT_CLASS WaterRejectionTouchT<GridW, GridH, History, MaxPoints>
+
+#ifdef WATER_REJECTION_PROFILE
+  #define WRT_PROFILE_STAGE(stage) StageTimer stageTimer(this, stage)
+#else
+  #define WRT_PROFILE_STAGE(stage)
+#endif
+
+// Constructor
+WRT_TEMPLATE
+WRT_CLASS::WaterRejectionTouchT(uint16_t width, uint16_t height) 
+    : zoneGeneration(1), generationStart(0),
+      updateDeadline(WATER_REJECTION_NO_DEADLINE),
+      screenWidth(width), screenHeight(height),
+      gestureState(GESTURE_IDLE), gestureStateTimeout(0),
+      currentTouchCount(0), nextContactId(1), waterDropletsRejected(0), validTouches(0),
+      adaptiveWetMode(false), wetnessLevel(0), wetnessEvidence(0),
+      lastValidTouchTime(0) {
+    
+    #ifdef WATER_REJECTION_PROFILE
+    resetProfile();
+    #endif
+    
+    // Set screen type based on compile-time definition
+    #ifdef RESISTIVE_SCREEN
+    screenType = SCREEN_RESISTIVE;
+    #else
+    screenType = SCREEN_CAPACITIVE;
+    #endif
+    userStreakWindow = config.streakWindow;
+    
+    // Only the left-edge swipe unlocks until configured otherwise
+    memset(gestureUnlockTimes, 0, sizeof(gestureUnlockTimes));
+    gestureUnlockTimes[UNLOCK_SWIPE_RIGHT] = 30;
+    clearGesture();
+    
+    // Initialize arrays
+    clearZones();
+    for (uint8_t i = 0; i < MAX_TOUCH_POINTS; i++) {
+        multiTouchPoints[i] = TouchPoint();
+    }
+    lastValidTouch = TouchPoint();
+    for (uint8_t c = 0; c < MAX_TOUCH_POINTS; c++) {
+        releaseContact(contacts[c]);
+    }
+    resetStatistics();
+    
+    updateZoneScale();
+}
+
+// Initialize with default configuration
+WRT_TEMPLATE
+void WRT_CLASS::begin() {
+    // Configuration is already set to defaults in struct definition
+    begin(config);
+}
+
+// Initialize with custom configuration
+WRT_TEMPLATE
+void WRT_CLASS::begin(const WaterRejectionConfig& customConfig) {
+    config = customConfig;
+    userStreakWindow = config.streakWindow;
+    
+    // Clear all tracking data
+    touchHistory.clear();
+    for (uint8_t c = 0; c < MAX_TOUCH_POINTS; c++) {
+        releaseContact(contacts[c]);
+    }
+    clearZones();
+    #ifdef WATER_REJECTION_COMPACT_ZONES
+    zoneEpoch = waterRejectionNow();
+    #endif
+    zoneGeneration = 1;
+    generationStart = waterRejectionNow();
+    updateDeadline = WATER_REJECTION_NO_DEADLINE;
+    clearGesture();
+    resetStatistics();
+    
+    // Conditions are relearnt from dry
+    wetnessEvidence = 0;
+    if (adaptiveWetMode) {
+        applyWetness(0);
+    }
+    
+    #ifdef WATER_REJECTION_PROFILE
+    wrtStartCycleCounter();
+    resetProfile();
+    #endif
+}
+
+// Main touch processing function
+WRT_TEMPLATE
+bool WRT_CLASS::processTouch(int16_t x, int16_t y) {
+    TouchPoint touch = TouchPoint();
+    touch.x = x;
+    touch.y = y;
+    touch.timestamp = waterRejectionNow();
+    touch.pressure = 128;  // Default pressure
+    touch.area = 10;       // Default area
+    touch.valid = true;
+    
+    return processTouchAt(touch, touch.timestamp);
+}
+
+WRT_TEMPLATE
+bool WRT_CLASS::processTouch(int16_t x, int16_t y, uint8_t pressure) {
+    TouchPoint touch = TouchPoint();
+    touch.x = x;
+    touch.y = y;
+    touch.timestamp = waterRejectionNow();
+    touch.pressure = pressure;
+    touch.area = pressure / 5;  // Estimate area from pressure
+    touch.valid = true;
+    
+    return processTouchAt(touch, touch.timestamp);
+}
+
+WRT_TEMPLATE
+bool WRT_CLASS::processTouch(const TouchPoint& touch) {
+    return processTouchAt(touch, waterRejectionNow());
+}
+
+WRT_TEMPLATE
+bool WRT_CLASS::processTouch(const TouchPoint& touch, uint32_t now) {
+    return processTouchAt(touch, now);
+}
+
+// Process a burst of buffered touches
+WRT_TEMPLATE
+size_t WRT_CLASS::processBatch(const TouchPoint* touches, size_t count, uint8_t* verdicts) {
+    return processBatch(touches, count, verdicts, waterRejectionNow());
+}
+
+WRT_TEMPLATE
+size_t WRT_CLASS::processBatch(const TouchPoint* touches, size_t count, uint8_t* verdicts,
+                               uint32_t currentTime) {
+    size_t accepted = 0;
+    
+    // Samples run in order: each accepted touch feeds the zone and static
+    // checks of the ones after it, exactly as a processTouch() loop would
+    for (size_t i = 0; i < count; i++) {
+        bool valid = processTouchAt(touches[i], currentTime);
+        if (verdicts) {
+            verdicts[i] = valid;
+        }
+        accepted += valid;
+    }
+    
+    return accepted;
+}
+
+// Drain a sample queue filled from an interrupt or driver task
+WRT_TEMPLATE
+template <uint8_t Capacity>
+size_t WRT_CLASS::drain(TouchSampleQueueT<Capacity>& queue, TouchPoint* lastAccepted) {
+    const uint8_t CHUNK_SIZE = 8;
+    TouchPoint chunk[CHUNK_SIZE];
+    uint8_t verdicts[CHUNK_SIZE];
+    size_t accepted = 0;
+    uint8_t count;
+    
+    while ((count = queue.pop(chunk, CHUNK_SIZE)) > 0) {
+        accepted += processBatch(chunk, count, verdicts);
+        
+        if (lastAccepted) {
+            for (uint8_t i = count; i > 0; i--) {
+                if (verdicts[i - 1]) {
+                    *lastAccepted = chunk[i - 1];
+                    break;
+                }
+            }
+        }
+    }
+    
+    return accepted;
+}
+
+// Filter pipeline shared by processTouch() and processBatch()
+WRT_TEMPLATE
+bool WRT_CLASS::processTouchAt(const TouchPoint& touch, uint32_t currentTime) {
+    return processTouchAt(touch, currentTime, touchHistory, lastValidTouch, lastValidTouchTime);
+}
+
+// Filter pipeline against one finger's history and debounce state
+WRT_TEMPLATE
+template <class HistoryT>
+bool WRT_CLASS::processTouchAt(const TouchPoint& touch, uint32_t currentTime, HistoryT& history,
+                               TouchPoint& lastValid, uint32_t& lastValidTime) {
+    bool held = false;
+    RejectReason reason = precheckTouch(touch, lastValid, lastValidTime, held);
+    if (held) {
+        return true;
+    }
+    if (reason != REJECT_NONE) {
+        rejectCounts[reason]++;
+        return false;
+    }
+    
+    // Map to the zone grid once for the pattern check and the zone update
+    ZoneCoord zone = mapToZone(touch);
+    
+    // Check for water droplet patterns
+    reason = isWaterPattern(touch, zone, currentTime);
+    if (reason != REJECT_NONE) {
+        rejectCounts[reason]++;
+        waterDropletsRejected++;
+        return false;
+    }
+    
+    // Check for static touch (water doesn't move)
+    if (isStaticTouch(touch, history)) {
+        rejectCounts[REJECT_STATIC]++;
+        waterDropletsRejected++;
+        return false;
+    }
+    
+    // ...or moves slowly and steadily downhill
+    if (isStreakTouch(touch, history)) {
+        rejectCounts[REJECT_STREAK]++;
+        waterDropletsRejected++;
+        return false;
+    }
+    
+    // Update tracking data
+    {
+        WRT_PROFILE_STAGE(PROFILE_UPDATE);
+        updateHistory(touch, history);
+        updateZones(touch, zone);
+    }
+    
+    // Update last valid touch info
+    lastValidTime = touch.timestamp;
+    lastValid = touch;
+    
+    validTouches++;
+    return true;
+}
+
+// Stages ahead of the water checks: bounds, statistics, resistive pressure and
+// debounce, gesture lock. held is set for a debounced repeat of the last
+// valid touch, which is accepted without being tracked again.
+WRT_TEMPLATE
+RejectReason WRT_CLASS::precheckTouch(const TouchPoint& touch, TouchPoint& lastValid,
+                                      uint32_t& lastValidTime, bool& held) {
+    // Bounds checking
+    if (touch.x < 0 || touch.x >= screenWidth || 
+        touch.y < 0 || touch.y >= screenHeight) {
+        return REJECT_BOUNDS;
+    }
+    
+    #ifdef WATER_REJECTION_HISTOGRAMS
+    areaHistogram[log2Bin(touch.area, STATS_AREA_BINS)]++;
+    if (hasLastSample) {
+        uint32_t interval = (touch.timestamp - lastSampleTime) / WATER_REJECTION_TICKS_PER_MS;
+        intervalHistogram[log2Bin(interval, STATS_INTERVAL_BINS)]++;
+    }
+    lastSampleTime = touch.timestamp;
+    hasLastSample = true;
+    #endif
+    
+    if (adaptiveWetMode) {
+        observeTouches(&touch, 1);
+    }
+    
+    // Resistive screen specific processing
+    if (screenType == SCREEN_RESISTIVE) {
+        WRT_PROFILE_STAGE(PROFILE_DEBOUNCE);
+        
+        // Check pressure threshold (if available)
+        if (config.pressureThreshold > 0 && touch.pressure < config.pressureThreshold) {
+            return REJECT_PRESSURE;  // Too light, probably false touch
+        }
+        
+        // Apply debouncing
+        if (config.debounceTime > 0) {
+            uint32_t timeSinceLastTouch = touch.timestamp - lastValidTime;
+            if (timeSinceLastTouch < waterRejectionTicks(config.debounceTime)) {
+                // Within debounce period - check if it's the same touch
+                int16_t dx = abs(touch.x - lastValid.x);
+                int16_t dy = abs(touch.y - lastValid.y);
+                
+                if (dx < config.minMovement && dy < config.minMovement) {
+                    held = true;  // Same touch position, allow it
+                    return REJECT_NONE;
+                }
+                return REJECT_DEBOUNCE;  // Different position within debounce time, reject
+            }
+        }
+    }
+    
+    // Check if gesture is required and validate
+    if (config.requireGesture && !validateGesture(touch)) {
+        return REJECT_GESTURE;
+    }
+    return REJECT_NONE;
+}
+
+// Scored classification
+WRT_TEMPLATE
+uint8_t WRT_CLASS::classifyTouch(const TouchPoint& touch) {
+    return classifyTouch(touch, waterRejectionNow());
+}
+
+WRT_TEMPLATE
+uint8_t WRT_CLASS::classifyTouch(const TouchPoint& touch, uint32_t currentTime) {
+    bool held = false;
+    RejectReason reason = precheckTouch(touch, lastValidTouch, lastValidTouchTime, held);
+    if (held) {
+        return 0;
+    }
+    if (reason != REJECT_NONE) {
+        rejectCounts[reason]++;
+        return 255;
+    }
+    
+    ZoneCoord zone = mapToZone(touch);
+    uint8_t score = scoreTouch(touch, zone, currentTime, reason);
+    if (score >= config.scoreThreshold) {
+        rejectCounts[reason]++;
+        waterDropletsRejected++;
+        return score;
+    }
+    
+    {
+        WRT_PROFILE_STAGE(PROFILE_UPDATE);
+        updateHistory(touch, touchHistory);
+        updateZones(touch, zone);
+    }
+    lastValidTouchTime = touch.timestamp;
+    lastValidTouch = touch;
+    validTouches++;
+    return score;
+}
+
+// Process multiple simultaneous touches
+WRT_TEMPLATE
+bool WRT_CLASS::processMultiTouch(TouchPoint* touches, uint8_t count) {
+    return processMultiTouch(touches, count, waterRejectionNow());
+}
+
+WRT_TEMPLATE
+bool WRT_CLASS::processMultiTouch(TouchPoint* touches, uint8_t count, uint32_t currentTime,
+                                  uint8_t* verdicts) {
+    currentTouchCount = count;
+    if (verdicts) {
+        memset(verdicts, 0, count);      // Until a touch is accepted below
+    }
+    
+    // Follow each finger from the previous frame, even if this one is rejected
+    uint8_t slots[MAX_TOUCH_POINTS];
+    trackContacts(touches, count, currentTime, slots);
+    
+    // A two-finger hold unlocks before the frame itself is judged
+    if (config.requireGesture && gestureState != GESTURE_ACTIVE &&
+        gestureUnlockTimes[UNLOCK_TWO_FINGER_HOLD] > 0) {
+        trackTwoFingerHold(touches, count);
+    }
+    
+    // Too many simultaneous touches indicate water
+    if (count > config.maxSimultaneousTouches) {
+        rejectCounts[REJECT_TOUCH_COUNT]++;
+        waterDropletsRejected++;
+        if (adaptiveWetMode) {
+            observeTouches(touches, count);
+        }
+        return false;
+    }
+    
+    // Copy touches for analysis
+    for (uint8_t i = 0; i < count && i < MAX_TOUCH_POINTS; i++) {
+        multiTouchPoints[i] = touches[i];
+    }
+    
+    // Check multi-touch patterns
+    RejectReason reason = checkMultiTouchPattern();
+    if (reason != REJECT_NONE) {
+        rejectCounts[reason]++;
+        waterDropletsRejected++;
+        if (adaptiveWetMode) {
+            observeTouches(touches, count);
+        }
+        return false;
+    }
+    
+    // Process each touch against its own contact; touches beyond the
+    // tracked ones fall back to the shared single-touch state
+    bool anyValid = false;
+    for (uint8_t i = 0; i < count; i++) {
+        bool valid;
+        if (i < MAX_TOUCH_POINTS) {
+            Contact& contact = contacts[slots[i]];
+            valid = processTouchAt(touches[i], currentTime, contact.history,
+                                   contact.lastValidTouch, contact.lastValidTouchTime);
+        } else {
+            valid = processTouchAt(touches[i], currentTime);
+        }
+        if (valid) {
+            anyValid = true;
+            if (verdicts) {
+                verdicts[i] = 1;
+            }
+        }
+    }
+    
+    return anyValid;
+}
+
+// Match this frame's touches to last frame's contacts, closest pairs first.
+// Unmatched touches start new contacts, unmatched contacts are released.
+// slots[i] receives the contact slot of touches[i].
+WRT_TEMPLATE
+void WRT_CLASS::trackContacts(TouchPoint* touches, uint8_t count, uint32_t currentTime,
+                              uint8_t* slots) {
+    const uint8_t UNMATCHED = 0xFF;
+    uint8_t tracked = count < MAX_TOUCH_POINTS ? count : MAX_TOUCH_POINTS;
+    bool contactMatched[MAX_TOUCH_POINTS];
+    
+    for (uint8_t i = 0; i < MAX_TOUCH_POINTS; i++) {
+        slots[i] = UNMATCHED;
+        contactMatched[i] = false;
+    }
+    
+    // A contact not reported for touchTimeout lifted during frames the
+    // caller never sent, so a new touch there is a new finger
+    for (uint8_t c = 0; c < MAX_TOUCH_POINTS; c++) {
+        if (contacts[c].id != 0 && isContactStale(contacts[c], currentTime)) {
+            releaseContact(contacts[c]);
+        }
+    }
+    
+    // Greedy nearest pairs - at most MAX_TOUCH_POINTS rounds over a
+    // MAX_TOUCH_POINTS^2 table, which is tiny for real controllers
+    uint32_t maxDistance = (uint32_t)config.contactMatchDistance * config.contactMatchDistance;
+    for (uint8_t round = 0; round < tracked; round++) {
+        uint32_t bestDistance = maxDistance + 1;
+        uint8_t bestTouch = UNMATCHED;
+        uint8_t bestContact = UNMATCHED;
+        
+        for (uint8_t t = 0; t < tracked; t++) {
+            if (slots[t] != UNMATCHED) {
+                continue;
+            }
+            for (uint8_t c = 0; c < MAX_TOUCH_POINTS; c++) {
+                if (contacts[c].id == 0 || contactMatched[c]) {
+                    continue;
+                }
+                int32_t dx = touches[t].x - contacts[c].lastPosition.x;
+                int32_t dy = touches[t].y - contacts[c].lastPosition.y;
+                uint32_t distance = (uint32_t)(dx * dx) + (uint32_t)(dy * dy);
+                if (distance < bestDistance) {
+                    bestDistance = distance;
+                    bestTouch = t;
+                    bestContact = c;
+                }
+            }
+        }
+        
+        if (bestTouch == UNMATCHED) {
+            break;  // Nothing left within contactMatchDistance
+        }
+        slots[bestTouch] = bestContact;
+        contactMatched[bestContact] = true;
+    }
+    
+    // Fingers that lifted
+    for (uint8_t c = 0; c < MAX_TOUCH_POINTS; c++) {
+        if (contacts[c].id != 0 && !contactMatched[c]) {
+            releaseContact(contacts[c]);
+        }
+    }
+    
+    // New fingers take free slots
+    for (uint8_t t = 0; t < tracked; t++) {
+        if (slots[t] != UNMATCHED) {
+            continue;
+        }
+        for (uint8_t c = 0; c < MAX_TOUCH_POINTS; c++) {
+            if (contacts[c].id == 0) {
+                contacts[c].id = nextContactId;
+                nextContactId = nextContactId == 0xFF ? 1 : nextContactId + 1;
+                slots[t] = c;
+                break;
+            }
+        }
+    }
+    
+    for (uint8_t t = 0; t < tracked; t++) {
+        Contact& contact = contacts[slots[t]];
+        contact.lastPosition = touches[t];
+        touches[t].id = contact.id;
+    }
+    for (uint8_t t = tracked; t < count; t++) {
+        touches[t].id = 0;
+    }
+}
+
+WRT_TEMPLATE
+void WRT_CLASS::releaseContact(Contact& contact) {
+    contact.id = 0;
+    contact.history.clear();
+    contact.lastValidTouchTime = 0;
+    contact.lastValidTouch = TouchPoint();
+}
+
+WRT_TEMPLATE
+bool WRT_CLASS::isContactStale(const Contact& contact, uint32_t currentTime) const {
+    return currentTime - contact.lastPosition.timestamp > waterRejectionTicks(config.touchTimeout);
+}
+
+WRT_TEMPLATE
+uint8_t WRT_CLASS::getActiveContactCount() const {
+    uint32_t currentTime = waterRejectionNow();
+    uint8_t active = 0;
+    for (uint8_t c = 0; c < MAX_TOUCH_POINTS; c++) {
+        if (contacts[c].id != 0 && !isContactStale(contacts[c], currentTime)) {
+            active++;
+        }
+    }
+    return active;
+}
+
+// Check if touch exhibits water droplet characteristics
+WRT_TEMPLATE
+RejectReason WRT_CLASS::isWaterPattern(const TouchPoint& touch, const ZoneCoord& zone,
+                                       uint32_t currentTime) {
+    WRT_PROFILE_STAGE(PROFILE_WATER);
+    
+    // The controller has already seen it is water - no need to look
+    if (touch.flags & TOUCH_FLAG_HW_WATER) {
+        return REJECT_HARDWARE;
+    }
+    
+    // Large touch area indicates water
+    if (touch.area > config.maxTouchArea) {
+        return REJECT_AREA;
+    }
+    
+    // Check zone activity
+    return checkZoneActivity(zone.x, zone.y, currentTime);
+}
+
+// Check zone activity for water detection
+WRT_TEMPLATE
+RejectReason WRT_CLASS::checkZoneActivity(uint8_t zoneX, uint8_t zoneY, uint32_t currentTime) {
+    advanceGeneration(currentTime);
+    
+    // Rapid repeated touches in same zone
+    if (countZoneBurst(zoneIndexOf(zoneX, zoneY), currentTime) > 3) {
+        return REJECT_ZONE_BURST;  // Water detected
+    }
+    
+    // Too many active neighboring zones indicates water spread
+    if (countLiveNeighbors(zoneX, zoneY, currentTime) > 4) {
+        return REJECT_NEIGHBOR_SPREAD;
+    }
+    
+    // ...and zones lit all over the panel indicate a sheet of it
+    if (config.maxActiveRegions > 0 &&
+        countLiveRegions(currentTime) > config.maxActiveRegions) {
+        return REJECT_WIDE_SPREAD;
+    }
+    return REJECT_NONE;
+}
+
+// Count this touch against its zone if the zone was activated within the
+// last 100 ms. Returns the zone's count including it, 0 when not a burst.
+WRT_TEMPLATE
+uint8_t WRT_CLASS::countZoneBurst(uint16_t zoneIndex, uint32_t currentTime) {
+    if (!isZoneLive(zoneIndex, currentTime) ||
+        getZoneActivationAge(zoneIndex, currentTime) >= waterRejectionTicks(100)) {
+        return 0;
+    }
+    uint8_t touchCount = getZoneTouchCount(zoneIndex) + 1;
+    setZoneTouchCount(zoneIndex, touchCount);
+    return touchCount;
+}
+
+// Live zones in the 3x3 block around a zone, itself included (water spreads)
+WRT_TEMPLATE
+uint8_t WRT_CLASS::countLiveNeighbors(uint8_t zoneX, uint8_t zoneY, uint32_t currentTime) const {
+    uint8_t activeNeighbors = 0;
+    for (int8_t dx = -1; dx <= 1; dx++) {
+        for (int8_t dy = -1; dy <= 1; dy++) {
+            uint8_t nx = zoneX + dx;
+            uint8_t ny = zoneY + dy;
+            
+            if (nx < ZONE_GRID_WIDTH && ny < ZONE_GRID_HEIGHT && 
+                isZoneLive(zoneIndexOf(nx, ny), currentTime)) {
+                uint32_t neighborTime = getZoneActivationAge(zoneIndexOf(nx, ny), currentTime);
+                if (neighborTime < waterRejectionTicks(config.touchTimeout)) {
+                    activeNeighbors++;
+                }
+            }
+        }
+    }
+    return activeNeighbors;
+}
+
+// Every feature at once, each scaled to 128 where its processTouch() check
+// fires, then mixed with the configured Q8 weights. strongest receives the
+// reason of the largest contribution.
+WRT_TEMPLATE
+uint8_t WRT_CLASS::scoreTouch(const TouchPoint& touch, const ZoneCoord& zone,
+                              uint32_t currentTime, RejectReason& strongest) {
+    if (touch.flags & TOUCH_FLAG_HW_WATER) {
+        strongest = REJECT_HARDWARE;
+        return 255;
+    }
+    
+    const WaterScoreWeights& weights = config.scoreWeights;
+    uint32_t contributions[5];
+    RejectReason reasons[5] = {
+        REJECT_AREA, REJECT_ZONE_BURST, REJECT_NEIGHBOR_SPREAD, REJECT_STATIC, REJECT_STREAK
+    };
+    
+    {
+        WRT_PROFILE_STAGE(PROFILE_WATER);
+        advanceGeneration(currentTime);
+        
+        contributions[0] = (uint32_t)weights.area * scoreFeature(touch.area, config.maxTouchArea + 1);
+        contributions[1] = (uint32_t)weights.zoneBurst *
+                           scoreFeature(countZoneBurst(zone.index, currentTime), 4);
+        
+        uint8_t spread = scoreFeature(countLiveNeighbors(zone.x, zone.y, currentTime), 5);
+        if (config.maxActiveRegions > 0) {
+            uint8_t regions = scoreFeature(countLiveRegions(currentTime), config.maxActiveRegions + 1);
+            if (regions > spread) {
+                spread = regions;
+                reasons[2] = REJECT_WIDE_SPREAD;
+            }
+        }
+        contributions[2] = (uint32_t)weights.spread * spread;
+    }
+    
+    // Fully static or streaking is past the limit; half the static count is halfway
+    uint8_t staticFeature = 0;
+    if (isStaticTouch(touch, touchHistory)) {
+        staticFeature = 160;
+    } else if (touchHistory.isStatic(touch, config.minMovement,
+                                     waterRejectionTicks(config.maxStaticTime), 2)) {
+        staticFeature = 64;
+    }
+    contributions[3] = (uint32_t)weights.staticTouch * staticFeature;
+    contributions[4] = (uint32_t)weights.streak * (isStreakTouch(touch, touchHistory) ? 160 : 0);
+    
+    uint32_t total = 0;
+    uint8_t largest = 0;
+    for (uint8_t i = 0; i < 5; i++) {
+        total += contributions[i];
+        if (contributions[i] > contributions[largest]) {
+            largest = i;
+        }
+    }
+    strongest = reasons[largest];
+    total >>= 8;
+    return total > 255 ? 255 : total;
+}
+
+// 0 up to half the limit, then linear through 128 at the limit to 255
+WRT_TEMPLATE
+uint8_t WRT_CLASS::scoreFeature(uint32_t value, uint32_t limit) {
+    if (value * 2 <= limit) {
+        return 0;
+    }
+    uint32_t feature = (value * 2 - limit) * 128 / limit;
+    return feature > 255 ? 255 : feature;
+}
+
+// Check multi-touch patterns for water detection
+WRT_TEMPLATE
+RejectReason WRT_CLASS::checkMultiTouchPattern() {
+    if (currentTouchCount < 2) {
+        return REJECT_NONE;
+    }
+    
+    #ifdef WATER_REJECTION_FIXED_POINT
+    // Water creates tight clusters of touches
+    if (currentTouchCount > 2 && isTightCluster()) {
+        return REJECT_CLUSTER;
+    }
+    
+    // Check for line pattern (water running down screen)
+    if (currentTouchCount >= 3 && isLinePattern()) {
+        return REJECT_LINE;
+    }
+    #else
+    float clusterDensity = calculateTouchClusterDensity();
+    
+    // Water creates tight clusters of touches
+    if (clusterDensity < 50.0f && currentTouchCount > 2) {
+        return REJECT_CLUSTER;
+    }
+    
+    // Check for line pattern (water running down screen)
+    if (currentTouchCount >= 3) {
+        // Calculate if touches form a line
+        float sumX = 0, sumY = 0, sumXY = 0, sumX2 = 0;
+        
+        for (uint8_t i = 0; i < currentTouchCount && i < MAX_TOUCH_POINTS; i++) {
+            sumX += multiTouchPoints[i].x;
+            sumY += multiTouchPoints[i].y;
+            sumXY += multiTouchPoints[i].x * multiTouchPoints[i].y;
+            sumX2 += multiTouchPoints[i].x * multiTouchPoints[i].x;
+        }
+        
+        float n = currentTouchCount;
+        float correlation = (n * sumXY - sumX * sumY) / 
+                           sqrt((n * sumX2 - sumX * sumX) * (n * sumY * sumY - sumY * sumY));
+        
+        // High correlation indicates line pattern (water streak)
+        if (abs(correlation) > 0.9f) {
+            return REJECT_LINE;
+        }
+    }
+    
+    #endif
+    
+    return REJECT_NONE;
+}
+
+#ifdef WATER_REJECTION_FIXED_POINT
+// Number of stored points used by the integer pattern checks
+WRT_TEMPLATE
+uint8_t WRT_CLASS::getAnalysedTouchCount() const {
+    return currentTouchCount < MAX_TOUCH_POINTS ? currentTouchCount : MAX_TOUCH_POINTS;
+}
+
+// Integer version of calculateTouchClusterDensity() < 50 px
+WRT_TEMPLATE
+bool WRT_CLASS::isTightCluster() {
+    static_assert(MaxPoints <= 16, "Fixed-point pattern checks support up to 16 points");
+    
+    const uint32_t CLUSTER_DISTANCE = 50;
+    uint8_t count = getAnalysedTouchCount();
+    uint8_t pairCount = 0;
+    uint8_t nearPairs = 0;
+    
+    // Squared distances settle most frames without a square root
+    for (uint8_t i = 0; i < count - 1; i++) {
+        for (uint8_t j = i + 1; j < count; j++) {
+            uint32_t dx = abs((int32_t)multiTouchPoints[i].x - multiTouchPoints[j].x);
+            uint32_t dy = abs((int32_t)multiTouchPoints[i].y - multiTouchPoints[j].y);
+            if (dx < CLUSTER_DISTANCE && dy < CLUSTER_DISTANCE &&
+                dx * dx + dy * dy < CLUSTER_DISTANCE * CLUSTER_DISTANCE) {
+                nearPairs++;
+            }
+            pairCount++;
+        }
+    }
+    
+    if (nearPairs == pairCount) {
+        return true;   // Every pair is closer than the limit
+    }
+    if (nearPairs == 0) {
+        return false;  // Every pair is at least the limit apart
+    }
+    
+    // Mixed distances - compare the summed distances in Q2 (quarter pixels)
+    const uint32_t MAX_PAIR_DISTANCE = CLUSTER_DISTANCE * 120;  // Bound for the sums below
+    uint32_t limit = (CLUSTER_DISTANCE << 2) * pairCount;
+    uint32_t totalDistance = 0;
+    
+    for (uint8_t i = 0; i < count - 1; i++) {
+        for (uint8_t j = i + 1; j < count; j++) {
+            uint32_t dx = abs((int32_t)multiTouchPoints[i].x - multiTouchPoints[j].x);
+            uint32_t dy = abs((int32_t)multiTouchPoints[i].y - multiTouchPoints[j].y);
+            if (dx >= MAX_PAIR_DISTANCE || dy >= MAX_PAIR_DISTANCE) {
+                return false;  // This pair alone exceeds the average limit
+            }
+            totalDistance += isqrt((dx * dx + dy * dy) << 4);
+        }
+    }
+    
+    // Each floor() loses less than one unit, so the result is certain
+    // unless the sum lands within pairCount of the limit
+    if (totalDistance + pairCount <= limit) {
+        return true;
+    }
+    if (totalDistance >= limit) {
+        return false;
+    }
+    
+    // Too close to call - redo the sum in Q18, rounding to nearest, which is
+    // as fine as the float path resolves it
+    uint64_t preciseLimit = ((uint64_t)CLUSTER_DISTANCE << 18) * pairCount;
+    uint64_t preciseTotal = 0;
+    
+    for (uint8_t i = 0; i < count - 1; i++) {
+        for (uint8_t j = i + 1; j < count; j++) {
+            uint64_t dx = abs((int32_t)multiTouchPoints[i].x - multiTouchPoints[j].x);
+            uint64_t dy = abs((int32_t)multiTouchPoints[i].y - multiTouchPoints[j].y);
+            uint64_t squared = (dx * dx + dy * dy) << 36;
+            uint64_t distance = isqrt64(squared);
+            if (squared - distance * distance > distance) {
+                distance++;
+            }
+            preciseTotal += distance;
+        }
+    }
+    
+    return preciseTotal < preciseLimit;
+}
+
+// Integer version of the line correlation check (|correlation| > 0.9).
+// Uses the same terms as the float path so both make the same decision.
+WRT_TEMPLATE
+bool WRT_CLASS::isLinePattern() {
+    uint8_t count = getAnalysedTouchCount();
+    
+    // Keep coordinates below 2048 so every term fits in 64 bits; the
+    // correlation does not change when both axes are scaled
+    int32_t maxCoord = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        int32_t ax = abs((int32_t)multiTouchPoints[i].x);
+        int32_t ay = abs((int32_t)multiTouchPoints[i].y);
+        if (ax > maxCoord) maxCoord = ax;
+        if (ay > maxCoord) maxCoord = ay;
+    }
+    uint8_t shift = 0;
+    while ((maxCoord >> shift) >= 2048) {
+        shift++;
+    }
+    
+    int32_t sumX = 0, sumY = 0, sumXY = 0, sumX2 = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        int32_t x = multiTouchPoints[i].x >> shift;
+        int32_t y = multiTouchPoints[i].y >> shift;
+        sumX += x;
+        sumY += y;
+        sumXY += x * y;
+        sumX2 += x * x;
+    }
+    
+    int64_t n = count;
+    int64_t numerator = n * sumXY - (int64_t)sumX * sumY;
+    uint64_t spreadX = (uint64_t)(n * sumX2 - (int64_t)sumX * sumX);
+    uint64_t spreadY = (uint64_t)((n - 1) * sumY * sumY);
+    uint64_t denominator = spreadX * spreadY;
+    
+    if (denominator == 0) {
+        return false;  // Degenerate frame, no line to fit
+    }
+    
+    // |numerator| / sqrt(denominator) > 0.9  <=>  numerator^2 > 0.81 * denominator
+    uint64_t squared = (uint64_t)(numerator < 0 ? -numerator : numerator);
+    squared *= squared;
+    uint64_t threshold = (denominator / 100) * 81 + ((denominator % 100) * 81) / 100;
+    return squared > threshold;
+}
+
+// Integer square roots (floor) without division
+WRT_TEMPLATE
+uint32_t WRT_CLASS::isqrt(uint32_t value) {
+    uint32_t result = 0;
+    uint32_t bit = 1UL << 30;
+    
+    while (bit > value) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (value >= result + bit) {
+            value -= result + bit;
+            result = (result >> 1) + bit;
+        } else {
+            result >>= 1;
+        }
+        bit >>= 2;
+    }
+    return result;
+}
+
+WRT_TEMPLATE
+uint32_t WRT_CLASS::isqrt64(uint64_t value) {
+    uint64_t result = 0;
+    uint64_t bit = 1ULL << 62;
+    
+    while (bit > value) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (value >= result + bit) {
+            value -= result + bit;
+            result = (result >> 1) + bit;
+        } else {
+            result >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t)result;
+}
+#else
+// Calculate density of touch cluster
+WRT_TEMPLATE
+float WRT_CLASS::calculateTouchClusterDensity() {
+    if (currentTouchCount < 2) {
+        return 1000.0f;  // Large value for single touch
+    }
+    
+    float totalDistance = 0;
+    uint8_t pairCount = 0;
+    
+    for (uint8_t i = 0; i < currentTouchCount - 1 && i < MAX_TOUCH_POINTS - 1; i++) {
+        for (uint8_t j = i + 1; j < currentTouchCount && j < MAX_TOUCH_POINTS; j++) {
+            float dx = multiTouchPoints[i].x - multiTouchPoints[j].x;
+            float dy = multiTouchPoints[i].y - multiTouchPoints[j].y;
+            totalDistance += sqrt(dx * dx + dy * dy);
+            pairCount++;
+        }
+    }
+    
+    return pairCount > 0 ? totalDistance / pairCount : 1000.0f;
+}
+#endif
+
+// Check if touch is static (not moving)
+WRT_TEMPLATE
+template <class HistoryT>
+bool WRT_CLASS::isStaticTouch(const TouchPoint& touch, HistoryT& history) {
+    WRT_PROFILE_STAGE(PROFILE_STATIC);
+    
+    // Too many static touches in same location
+    return history.isStatic(touch, config.minMovement, waterRejectionTicks(config.maxStaticTime), 5);
+}
+
+// Check if touch continues a slow straight drift (water running down)
+WRT_TEMPLATE
+template <class HistoryT>
+bool WRT_CLASS::isStreakTouch(const TouchPoint& touch, HistoryT& history) {
+    WRT_PROFILE_STAGE(PROFILE_STREAK);
+    
+    StreakLimits limits;
+    limits.window = waterRejectionTicks(config.streakWindow);
+    limits.minSamples = config.streakMinSamples;
+    limits.minSpeed = config.streakMinSpeed;
+    limits.maxSpeed = config.streakMaxSpeed;
+    limits.direction = config.streakDirection;
+    return history.isStreak(touch, limits);
+}
+
+// Update zone tracking
+WRT_TEMPLATE
+void WRT_CLASS::updateZones(const TouchPoint& touch, const ZoneCoord& zone) {
+    advanceGeneration(touch.timestamp);
+    
+    // A zone that has expired starts counting again
+    bool live = isZoneLive(zone.index, touch.timestamp);
+    stampZone(zone.index, touch.timestamp);
+    setZoneTouchCount(zone.index, live ? getZoneTouchCount(zone.index) + 1 : 1);
+    
+    // The region holds the zone's touch until a newer one
+    uint8_t region = regionOf(zone.index);
+    if (!isRegionLive(region, touch.timestamp) ||
+        isBefore(regionLastTouchTimes[region], touch.timestamp)) {
+        regionLastTouchTimes[region] = touch.timestamp;
+        regionTags[region] = zoneGeneration;
+    }
+}
+
+// Update touch history
+WRT_TEMPLATE
+template <class HistoryT>
+void WRT_CLASS::updateHistory(const TouchPoint& touch, HistoryT& history) {
+    history.push(touch);
+}
+
+// Flatten zone coordinates - a shift when GridH is a power of two
+WRT_TEMPLATE
+uint16_t WRT_CLASS::zoneIndexOf(uint8_t zoneX, uint8_t zoneY) {
+    return (uint16_t)zoneX * ZONE_GRID_HEIGHT + zoneY;
+}
+
+// Pull the update deadline earlier if this one comes first
+WRT_TEMPLATE
+void WRT_CLASS::scheduleUpdate(uint32_t deadline) {
+    if (deadline == WATER_REJECTION_NO_DEADLINE) {
+        deadline--;  // Never collide with the sentinel - one ms early is harmless
+    }
+    if (updateDeadline == WATER_REJECTION_NO_DEADLINE || isBefore(deadline, updateDeadline)) {
+        updateDeadline = deadline;
+    }
+}
+
+// Wrap-safe time comparison (valid for gaps below 24 days)
+WRT_TEMPLATE
+bool WRT_CLASS::isBefore(uint32_t time, uint32_t deadline) {
+    return (int32_t)(time - deadline) < 0;
+}
+
+#ifdef WATER_REJECTION_COMPACT_ZONES
+// Zone storage accessors - compact layout
+WRT_TEMPLATE
+void WRT_CLASS::clearZones() {
+    memset(zones, 0, sizeof(zones));
+    memset(zoneTouchCounts, 0, sizeof(zoneTouchCounts));
+    memset(zoneTags, 0, sizeof(zoneTags));
+    zoneEpoch = 0;
+    memset(regionLastTouchTimes, 0, sizeof(regionLastTouchTimes));
+    memset(regionTags, 0, sizeof(regionTags));
+}
+
+WRT_TEMPLATE
+uint8_t WRT_CLASS::getZoneTag(uint16_t zoneIndex) const {
+    return (zoneTags[zoneIndex >> 2] >> ((zoneIndex & 3) * 2)) & 3;
+}
+
+WRT_TEMPLATE
+void WRT_CLASS::setZoneTag(uint16_t zoneIndex, uint8_t tag) {
+    uint8_t shift = (zoneIndex & 3) * 2;
+    uint8_t& packed = zoneTags[zoneIndex >> 2];
+    packed = (packed & ~(3 << shift)) | (tag << shift);
+}
+
+WRT_TEMPLATE
+uint8_t WRT_CLASS::getZoneTouchCount(uint16_t zoneIndex) const {
+    uint8_t packed = zoneTouchCounts[zoneIndex >> 1];
+    return (zoneIndex & 1) ? (packed >> 4) : (packed & 0x0F);
+}
+
+WRT_TEMPLATE
+void WRT_CLASS::setZoneTouchCount(uint16_t zoneIndex, uint8_t count) {
+    if (count > MAX_ZONE_TOUCH_COUNT) {
+        count = MAX_ZONE_TOUCH_COUNT;
+    }
+    uint8_t& packed = zoneTouchCounts[zoneIndex >> 1];
+    if (zoneIndex & 1) {
+        packed = (packed & 0x0F) | (count << 4);
+    } else {
+        packed = (packed & 0xF0) | count;
+    }
+}
+
+WRT_TEMPLATE
+uint32_t WRT_CLASS::getZoneActivationAge(uint16_t zoneIndex, uint32_t currentTime) const {
+    uint16_t relativeTime = (uint16_t)((currentTime - zoneEpoch) >> ZONE_TIME_SHIFT);
+    return (uint32_t)(uint16_t)(relativeTime - zones[zoneIndex].activationTime) << ZONE_TIME_SHIFT;
+}
+
+WRT_TEMPLATE
+uint32_t WRT_CLASS::getZoneIdleTime(uint16_t zoneIndex, uint32_t currentTime) const {
+    uint16_t relativeTime = (uint16_t)((currentTime - zoneEpoch) >> ZONE_TIME_SHIFT);
+    return (uint32_t)(uint16_t)(relativeTime - zones[zoneIndex].lastTouchTime) << ZONE_TIME_SHIFT;
+}
+
+WRT_TEMPLATE
+void WRT_CLASS::stampZone(uint16_t zoneIndex, uint32_t timestamp) {
+    uint16_t relativeTime = (uint16_t)((timestamp - zoneEpoch) >> ZONE_TIME_SHIFT);
+    zones[zoneIndex].activationTime = relativeTime;
+    zones[zoneIndex].lastTouchTime = relativeTime;
+    setZoneTag(zoneIndex, zoneGeneration);
+}
+#else
+// Zone storage accessors - plain layout
+WRT_TEMPLATE
+void WRT_CLASS::clearZones() {
+    memset(zoneActivationTimes, 0, sizeof(zoneActivationTimes));
+    memset(zoneLastTouchTimes, 0, sizeof(zoneLastTouchTimes));
+    memset(zoneTouchCounts, 0, sizeof(zoneTouchCounts));
+    memset(zoneTags, 0, sizeof(zoneTags));
+    memset(regionLastTouchTimes, 0, sizeof(regionLastTouchTimes));
+    memset(regionTags, 0, sizeof(regionTags));
+}
+
+WRT_TEMPLATE
+uint8_t WRT_CLASS::getZoneTag(uint16_t zoneIndex) const {
+    return zoneTags[zoneIndex];
+}
+
+WRT_TEMPLATE
+void WRT_CLASS::setZoneTag(uint16_t zoneIndex, uint8_t tag) {
+    zoneTags[zoneIndex] = tag;
+}
+
+WRT_TEMPLATE
+uint8_t WRT_CLASS::getZoneTouchCount(uint16_t zoneIndex) const {
+    return zoneTouchCounts[zoneIndex];
+}
+
+WRT_TEMPLATE
+void WRT_CLASS::setZoneTouchCount(uint16_t zoneIndex, uint8_t count) {
+    zoneTouchCounts[zoneIndex] = count;
+}
+
+WRT_TEMPLATE
+uint32_t WRT_CLASS::getZoneActivationAge(uint16_t zoneIndex, uint32_t currentTime) const {
+    return currentTime - zoneActivationTimes[zoneIndex];
+}
+
+WRT_TEMPLATE
+uint32_t WRT_CLASS::getZoneIdleTime(uint16_t zoneIndex, uint32_t currentTime) const {
+    return currentTime - zoneLastTouchTimes[zoneIndex];
+}
+
+WRT_TEMPLATE
+void WRT_CLASS::stampZone(uint16_t zoneIndex, uint32_t timestamp) {
+    zoneActivationTimes[zoneIndex] = timestamp;
+    zoneLastTouchTimes[zoneIndex] = timestamp;
+    zoneTags[zoneIndex] = zoneGeneration;
+}
+#endif
+
+// Start the generations that have begun since the last call, retiring the
+// tag each one reuses. Every tag is stale after ZONE_GENERATIONS spans.
+WRT_TEMPLATE
+void WRT_CLASS::advanceGeneration(uint32_t currentTime) {
+    // Touches stamped a little before the current generation began are not
+    // a wrap of the clock
+    uint32_t elapsed = currentTime - generationStart;
+    if (elapsed < ZONE_GENERATION_SPAN || generationStart - currentTime < ZONE_GENERATION_SPAN) {
+        return;
+    }
+    
+    uint32_t spans = elapsed / ZONE_GENERATION_SPAN;
+    generationStart += spans * ZONE_GENERATION_SPAN;
+    if (spans >= ZONE_GENERATIONS) {
+        for (uint16_t zoneIndex = 0; zoneIndex < ZONE_COUNT; zoneIndex++) {
+            setZoneTag(zoneIndex, 0);
+        }
+        memset(regionTags, 0, sizeof(regionTags));
+        return;
+    }
+    
+    while (spans-- > 0) {
+        zoneGeneration = zoneGeneration % ZONE_GENERATIONS + 1;
+        for (uint16_t zoneIndex = 0; zoneIndex < ZONE_COUNT; zoneIndex++) {
+            if (getZoneTag(zoneIndex) == zoneGeneration) {
+                setZoneTag(zoneIndex, 0);
+            }
+        }
+        for (uint8_t region = 0; region < REGION_COUNT; region++) {
+            if (regionTags[region] == zoneGeneration) {
+                regionTags[region] = 0;
+            }
+        }
+    }
+}
+
+// Tagged in this generation or the one before
+WRT_TEMPLATE
+bool WRT_CLASS::isCurrentTag(uint8_t tag) const {
+    uint8_t previous = zoneGeneration == 1 ? ZONE_GENERATIONS : zoneGeneration - 1;
+    return tag != 0 && (tag == zoneGeneration || tag == previous);
+}
+
+WRT_TEMPLATE
+bool WRT_CLASS::isZoneLive(uint16_t zoneIndex, uint32_t currentTime) const {
+    return isCurrentTag(getZoneTag(zoneIndex)) &&
+           getZoneIdleTime(zoneIndex, currentTime) <= waterRejectionTicks(config.touchTimeout);
+}
+
+WRT_TEMPLATE
+bool WRT_CLASS::isRegionLive(uint8_t region, uint32_t currentTime) const {
+    return isCurrentTag(regionTags[region]) &&
+           currentTime - regionLastTouchTimes[region] <= waterRejectionTicks(config.touchTimeout);
+}
+
+WRT_TEMPLATE
+uint8_t WRT_CLASS::countLiveRegions(uint32_t currentTime) const {
+    uint8_t live = 0;
+    for (uint8_t region = 0; region < REGION_COUNT; region++) {
+        if (isRegionLive(region, currentTime)) {
+            live++;
+        }
+    }
+    return live;
+}
+
+// Region of a zone - constant divisors, so multiplies and shifts
+WRT_TEMPLATE
+uint8_t WRT_CLASS::regionOf(uint16_t zoneIndex) {
+    uint16_t zoneX = zoneIndex / ZONE_GRID_HEIGHT;
+    uint16_t zoneY = zoneIndex % ZONE_GRID_HEIGHT;
+    return (uint8_t)(zoneX * REGION_GRID_SIZE / ZONE_GRID_WIDTH) * REGION_GRID_SIZE +
+           (uint8_t)(zoneY * REGION_GRID_SIZE / ZONE_GRID_HEIGHT);
+}
+
+WRT_TEMPLATE
+uint8_t WRT_CLASS::getActiveRegionCount() const {
+    return countLiveRegions(waterRejectionNow());
+}
+
+// Validate gesture for activation
+WRT_TEMPLATE
+bool WRT_CLASS::validateGesture(const TouchPoint& touch) {
+    WRT_PROFILE_STAGE(PROFILE_GESTURE);
+    
+    uint32_t currentTime = touch.timestamp;
+    
+    switch (gestureState) {
+        case GESTURE_IDLE:
+            // Check for gesture start (touch where an unlock stroke begins)
+            startGesture(touch);
+            return false;
+            
+        case GESTURE_WAITING: {
+            // Check for timeout
+            if (isBefore(gestureStateTimeout, currentTime)) {
+                gestureState = GESTURE_IDLE;
+                return false;
+            }
+            
+            // Check for stroke completion
+            UnlockGesture gesture = matchGesture(touch);
+            if (gesture != UNLOCK_NONE) {
+                unlockGesture(gesture, currentTime);
+                return true;
+            }
+            if (gestureCandidates == 0) {
+                gestureState = GESTURE_IDLE;     // Nothing left this stroke could be
+            }
+            return false;
+        }
+            
+        case GESTURE_ACTIVE:
+            // Check for timeout
+            if (isBefore(gestureStateTimeout, currentTime)) {
+                gestureState = GESTURE_IDLE;
+                return false;
+            }
+            return true;
+    }
+    
+    return false;
+}
+
+// Step of each swipe, indexed by UnlockGesture. A swipe starts at the edge
+// it moves away from.
+static const int8_t WRT_SWIPE_STEP_X[] = { 1, -1, 0, 0 };
+static const int8_t WRT_SWIPE_STEP_Y[] = { 0, 0, 1, -1 };
+
+WRT_TEMPLATE
+bool WRT_CLASS::isAtSwipeStart(const TouchPoint& touch, uint8_t gesture) const {
+    int32_t edge = config.edgeSwipeThreshold;
+    if (WRT_SWIPE_STEP_X[gesture] > 0) return touch.x < edge;
+    if (WRT_SWIPE_STEP_X[gesture] < 0) return touch.x >= (int32_t)screenWidth - edge;
+    if (WRT_SWIPE_STEP_Y[gesture] > 0) return touch.y < edge;
+    return touch.y >= (int32_t)screenHeight - edge;
+}
+
+// Begin matching every enabled stroke gesture that can start at touch
+WRT_TEMPLATE
+void WRT_CLASS::startGesture(const TouchPoint& touch) {
+    uint8_t candidates = 0;
+    for (uint8_t g = UNLOCK_SWIPE_RIGHT; g <= UNLOCK_SWIPE_UP; g++) {
+        if (gestureUnlockTimes[g] > 0 && isAtSwipeStart(touch, g)) {
+            candidates |= 1 << g;
+        }
+    }
+    if (gestureUnlockTimes[UNLOCK_L_SHAPE] > 0) {
+        candidates |= 1 << UNLOCK_L_SHAPE;  // Starts anywhere
+    }
+    if (candidates == 0) {
+        return;
+    }
+    
+    gestureState = GESTURE_WAITING;
+    gestureStateTimeout = touch.timestamp + waterRejectionTicks(config.gestureTimeout);
+    scheduleUpdate(gestureStateTimeout + 1);
+    gestureStartPoint = touch;
+    gestureCandidates = candidates;
+    gestureCornerReached = false;
+}
+
+// Advance every candidate by one sample - O(1), nothing is buffered.
+// Returns the first gesture completed, or UNLOCK_NONE.
+WRT_TEMPLATE
+UnlockGesture WRT_CLASS::matchGesture(const TouchPoint& touch) {
+    int32_t dx = (int32_t)touch.x - gestureStartPoint.x;
+    int32_t dy = (int32_t)touch.y - gestureStartPoint.y;
+    int32_t distance = config.swipeMinDistance;
+    
+    for (uint8_t g = UNLOCK_SWIPE_RIGHT; g <= UNLOCK_SWIPE_UP; g++) {
+        if ((gestureCandidates & (1 << g)) &&
+            WRT_SWIPE_STEP_X[g] * dx + WRT_SWIPE_STEP_Y[g] * dy > distance) {
+            return (UnlockGesture)g;
+        }
+    }
+    
+    // L-shape: each leg may wander by half a leg across its direction
+    if (gestureCandidates & (1 << UNLOCK_L_SHAPE)) {
+        int32_t slack = distance / 2;
+        if (!gestureCornerReached) {
+            if (abs(dx) > slack) {
+                gestureCandidates &= ~(1 << UNLOCK_L_SHAPE);
+            } else if (dy > distance) {
+                gestureCornerReached = true;
+                gestureCornerX = touch.x;
+                gestureCornerY = touch.y;
+            }
+        } else if (abs((int32_t)touch.y - gestureCornerY) > slack) {
+            gestureCandidates &= ~(1 << UNLOCK_L_SHAPE);
+        } else if ((int32_t)touch.x - gestureCornerX > distance) {
+            return UNLOCK_L_SHAPE;
+        }
+    }
+    
+    return UNLOCK_NONE;
+}
+
+WRT_TEMPLATE
+void WRT_CLASS::unlockGesture(UnlockGesture gesture, uint32_t currentTime) {
+    gestureState = GESTURE_ACTIVE;
+    unlockedBy = gesture;
+    gestureCandidates = 0;
+    holdTracking = false;
+    gestureStateTimeout = currentTime + waterRejectionTicks(gestureUnlockTimes[gesture] * 1000UL);
+    scheduleUpdate(gestureStateTimeout + 1);
+}
+
+// Two fingers whose midpoint and spacing stay within 2 * minMovement of
+// where they settled, for gestureHoldTime. Large contacts never count -
+// resting drops are what this must not mistake for fingers.
+WRT_TEMPLATE
+void WRT_CLASS::trackTwoFingerHold(const TouchPoint* touches, uint8_t count) {
+    if (count != 2 || touches[0].area > config.maxTouchArea ||
+        touches[1].area > config.maxTouchArea) {
+        holdTracking = false;
+        return;
+    }
+    
+    int16_t centerX = ((int32_t)touches[0].x + touches[1].x) / 2;
+    int16_t centerY = ((int32_t)touches[0].y + touches[1].y) / 2;
+    uint16_t spreadX = abs((int32_t)touches[0].x - touches[1].x);
+    uint16_t spreadY = abs((int32_t)touches[0].y - touches[1].y);
+    uint16_t spread = spreadX > spreadY ? spreadX : spreadY;
+    uint32_t currentTime = touches[0].timestamp;
+    int32_t tolerance = 2 * config.minMovement;
+    
+    if (!holdTracking || abs((int32_t)centerX - holdCenterX) > tolerance ||
+        abs((int32_t)centerY - holdCenterY) > tolerance ||
+        abs((int32_t)spread - holdSpread) > tolerance) {
+        // Fingers moved - the hold starts again from here
+        holdTracking = true;
+        holdStartTime = currentTime;
+        holdCenterX = centerX;
+        holdCenterY = centerY;
+        holdSpread = spread;
+        return;
+    }
+    
+    if (currentTime - holdStartTime >= waterRejectionTicks(config.gestureHoldTime)) {
+        unlockGesture(UNLOCK_TWO_FINGER_HOLD, currentTime);
+    }
+}
+
+// Back to locked, forgetting any stroke or hold in progress
+WRT_TEMPLATE
+void WRT_CLASS::clearGesture() {
+    gestureState = GESTURE_IDLE;
+    unlockedBy = UNLOCK_NONE;
+    gestureCandidates = 0;
+    gestureCornerReached = false;
+    holdTracking = false;
+}
+
+// Update function (call in loop)
+WRT_TEMPLATE
+uint32_t WRT_CLASS::update() {
+    return update(waterRejectionNow());
+}
+
+WRT_TEMPLATE
+uint32_t WRT_CLASS::update(uint32_t currentTime) {
+    // Nothing can expire before the deadline
+    if (updateDeadline == WATER_REJECTION_NO_DEADLINE || isBefore(currentTime, updateDeadline)) {
+        return updateDeadline;
+    }
+    
+    updateDeadline = WATER_REJECTION_NO_DEADLINE;
+    
+    // Update gesture timeout
+    if (gestureState == GESTURE_WAITING || gestureState == GESTURE_ACTIVE) {
+        if (isBefore(gestureStateTimeout, currentTime)) {
+            gestureState = GESTURE_IDLE;
+        } else {
+            scheduleUpdate(gestureStateTimeout + 1);
+        }
+    }
+    
+    return updateDeadline;
+}
+
+WRT_TEMPLATE
+uint32_t WRT_CLASS::nextDeadline() const {
+    return updateDeadline;
+}
+
+// Configuration methods
+WRT_TEMPLATE
+void WRT_CLASS::setConfig(const WaterRejectionConfig& newConfig) {
+    config = newConfig;
+    userStreakWindow = config.streakWindow;
+}
+
+WRT_TEMPLATE
+WaterRejectionConfig WRT_CLASS::getConfig() const {
+    return config;
+}
+
+WRT_TEMPLATE
+void WRT_CLASS::setMaxTouchArea(uint16_t area) {
+    config.maxTouchArea = area;
+}
+
+WRT_TEMPLATE
+void WRT_CLASS::setRequireGesture(bool require) {
+    config.requireGesture = require;
+    if (!require) {
+        clearGesture();
+    }
+}
+
+WRT_TEMPLATE
+void WRT_CLASS::setScreenDimensions(uint16_t width, uint16_t height) {
+    screenWidth = width;
+    screenHeight = height;
+    updateZoneScale();
+}
+
+// Precompute the pixel to zone reciprocals so mapping needs no division
+WRT_TEMPLATE
+void WRT_CLASS::updateZoneScale() {
+    zoneScaleX = screenWidth > 0 ?
+        (((uint32_t)ZONE_GRID_WIDTH << 24) + screenWidth - 1) / screenWidth : 0;
+    zoneScaleY = screenHeight > 0 ?
+        (((uint32_t)ZONE_GRID_HEIGHT << 24) + screenHeight - 1) / screenHeight : 0;
+}
+
+// Map an in-bounds touch to its zone
+WRT_TEMPLATE
+typename WRT_CLASS::ZoneCoord WRT_CLASS::mapToZone(const TouchPoint& touch) const {
+    ZoneCoord zone;
+    zone.x = ((uint32_t)touch.x * zoneScaleX) >> 24;
+    zone.y = ((uint32_t)touch.y * zoneScaleY) >> 24;
+    
+    // Only reachable for screens wider than 4096 px
+    if (zone.x >= ZONE_GRID_WIDTH) zone.x = ZONE_GRID_WIDTH - 1;
+    if (zone.y >= ZONE_GRID_HEIGHT) zone.y = ZONE_GRID_HEIGHT - 1;
+    
+    zone.index = zoneIndexOf(zone.x, zone.y);
+    return zone;
+}
+
+// Gesture control
+WRT_TEMPLATE
+void WRT_CLASS::enableGestureMode() {
+    config.requireGesture = true;
+    clearGesture();
+}
+
+WRT_TEMPLATE
+void WRT_CLASS::disableGestureMode() {
+    config.requireGesture = false;
+    clearGesture();
+}
+
+WRT_TEMPLATE
+bool WRT_CLASS::isGestureActive() const {
+    return gestureState == GESTURE_ACTIVE;
+}
+
+WRT_TEMPLATE
+void WRT_CLASS::resetGesture() {
+    clearGesture();
+}
+
+WRT_TEMPLATE
+void WRT_CLASS::setGestureUnlock(UnlockGesture gesture, uint16_t seconds) {
+    if (gesture < UNLOCK_GESTURE_COUNT) {
+        gestureUnlockTimes[gesture] = seconds < MAX_GESTURE_UNLOCK ? seconds : MAX_GESTURE_UNLOCK;
+    }
+}
+
+WRT_TEMPLATE
+uint16_t WRT_CLASS::getGestureUnlock(UnlockGesture gesture) const {
+    return gesture < UNLOCK_GESTURE_COUNT ? gestureUnlockTimes[gesture] : 0;
+}
+
+WRT_TEMPLATE
+UnlockGesture WRT_CLASS::getUnlockGesture() const {
+    return gestureState == GESTURE_ACTIVE ? unlockedBy : UNLOCK_NONE;
+}
+
+// Statistics
+WRT_TEMPLATE
+uint32_t WRT_CLASS::getWaterDropletsRejected() const {
+    return waterDropletsRejected;
+}
+
+WRT_TEMPLATE
+uint32_t WRT_CLASS::getValidTouches() const {
+    return validTouches;
+}
+
+WRT_TEMPLATE
+uint32_t WRT_CLASS::getRejectCount(RejectReason reason) const {
+    return reason < REJECT_REASON_COUNT ? rejectCounts[reason] : 0;
+}
+
+WRT_TEMPLATE
+void WRT_CLASS::resetStatistics() {
+    waterDropletsRejected = 0;
+    validTouches = 0;
+    memset(rejectCounts, 0, sizeof(rejectCounts));
+    #ifdef WATER_REJECTION_HISTOGRAMS
+    memset(areaHistogram, 0, sizeof(areaHistogram));
+    memset(intervalHistogram, 0, sizeof(intervalHistogram));
+    hasLastSample = false;
+    #endif
+    
+    // The adaptation window measures counter deltas, so restart it too
+    adaptSamples = 0;
+    adaptAreaSum = 0;
+    adaptPatternRejects = 0;
+}
+
+WRT_TEMPLATE
+WaterRejectionStats WRT_CLASS::getStatsSnapshot() const {
+    WaterRejectionStats snapshot;
+    snapshot.validTouches = validTouches;
+    snapshot.waterDropletsRejected = waterDropletsRejected;
+    memcpy(snapshot.rejectCounts, rejectCounts, sizeof(rejectCounts));
+    #ifdef WATER_REJECTION_HISTOGRAMS
+    memcpy(snapshot.areaHistogram, areaHistogram, sizeof(areaHistogram));
+    memcpy(snapshot.intervalHistogram, intervalHistogram, sizeof(intervalHistogram));
+    #endif
+    return snapshot;
+}
+
+WRT_TEMPLATE
+size_t WRT_CLASS::serializeStats(uint8_t* buffer, size_t length) const {
+    if (length < STATS_EXPORT_SIZE) {
+        return 0;
+    }
+    
+    // WaterRejectionStats is all uint32_t, so walk it as an array and write
+    // each value byte by byte - same layout on every target
+    WaterRejectionStats snapshot = getStatsSnapshot();
+    const uint32_t* values = (const uint32_t*)&snapshot;
+    const size_t valueCount = sizeof(snapshot) / sizeof(uint32_t);
+    
+    uint8_t* out = buffer;
+    *out++ = STATS_EXPORT_VERSION;
+    *out++ = REJECT_REASON_COUNT;
+    for (size_t i = 0; i < valueCount; i++) {
+        uint32_t value = values[i];
+        *out++ = value;
+        *out++ = value >> 8;
+        *out++ = value >> 16;
+        *out++ = value >> 24;
+    }
+    
+    return out - buffer;
+}
+
+// State snapshot
+WRT_TEMPLATE
+template <class T>
+void WRT_CLASS::StateWriter::field(const T& value) {
+    memcpy(out, (const void*)&value, sizeof(T));
+    out += sizeof(T);
+}
+
+WRT_TEMPLATE
+template <class T>
+void WRT_CLASS::StateReader::field(T& value) {
+    memcpy((void*)&value, in, sizeof(T));
+    in += sizeof(T);
+}
+
+// The one list of snapshot fields, walked by both streams. STATE_PAYLOAD_SIZE
+// must list the same fields.
+WRT_TEMPLATE
+template <class Self, class Stream>
+void WRT_CLASS::transferState(Self& self, Stream& stream) {
+    stream.field(self.touchHistory);
+    #ifdef WATER_REJECTION_COMPACT_ZONES
+    stream.field(self.zones);
+    stream.field(self.zoneTouchCounts);
+    stream.field(self.zoneTags);
+    stream.field(self.zoneEpoch);
+    #else
+    stream.field(self.zoneActivationTimes);
+    stream.field(self.zoneLastTouchTimes);
+    stream.field(self.zoneTouchCounts);
+    stream.field(self.zoneTags);
+    #endif
+    stream.field(self.zoneGeneration);
+    stream.field(self.generationStart);
+    stream.field(self.regionLastTouchTimes);
+    stream.field(self.regionTags);
+    stream.field(self.updateDeadline);
+    stream.field(self.touchEvents);
+    
+    stream.field(self.gestureState);
+    stream.field(self.gestureStateTimeout);
+    stream.field(self.gestureStartPoint);
+    stream.field(self.unlockedBy);
+    stream.field(self.gestureCandidates);
+    stream.field(self.gestureCornerReached);
+    stream.field(self.gestureCornerX);
+    stream.field(self.gestureCornerY);
+    stream.field(self.holdTracking);
+    stream.field(self.holdStartTime);
+    stream.field(self.holdCenterX);
+    stream.field(self.holdCenterY);
+    stream.field(self.holdSpread);
+    
+    stream.field(self.currentTouchCount);
+    stream.field(self.multiTouchPoints);
+    stream.field(self.contacts);
+    stream.field(self.nextContactId);
+    
+    stream.field(self.waterDropletsRejected);
+    stream.field(self.validTouches);
+    stream.field(self.rejectCounts);
+    #ifdef WATER_REJECTION_HISTOGRAMS
+    stream.field(self.areaHistogram);
+    stream.field(self.intervalHistogram);
+    stream.field(self.lastSampleTime);
+    stream.field(self.hasLastSample);
+    #endif
+    
+    stream.field(self.wetnessLevel);
+    stream.field(self.wetnessEvidence);
+    stream.field(self.adaptSamples);
+    stream.field(self.adaptAreaSum);
+    stream.field(self.adaptPatternRejects);
+    
+    stream.field(self.lastValidTouchTime);
+    stream.field(self.lastValidTouch);
+}
+
+// Move every absolute time in the state by shift ticks
+WRT_TEMPLATE
+void WRT_CLASS::rebaseState(uint32_t shift) {
+    touchHistory.rebase(shift);
+    #ifdef WATER_REJECTION_COMPACT_ZONES
+    zoneEpoch += shift;                  // Zone times are relative to it
+    #else
+    for (uint16_t zoneIndex = 0; zoneIndex < ZONE_COUNT; zoneIndex++) {
+        zoneActivationTimes[zoneIndex] += shift;
+        zoneLastTouchTimes[zoneIndex] += shift;
+    }
+    #endif
+    generationStart += shift;
+    for (uint8_t region = 0; region < REGION_COUNT; region++) {
+        regionLastTouchTimes[region] += shift;
+    }
+    if (updateDeadline != WATER_REJECTION_NO_DEADLINE) {
+        uint32_t deadline = updateDeadline + shift;
+        updateDeadline = WATER_REJECTION_NO_DEADLINE;
+        scheduleUpdate(deadline);
+    }
+    
+    gestureStateTimeout += shift;
+    gestureStartPoint.timestamp += shift;
+    holdStartTime += shift;
+    
+    for (uint8_t i = 0; i < MAX_TOUCH_POINTS; i++) {
+        multiTouchPoints[i].timestamp += shift;
+        Contact& contact = contacts[i];
+        contact.history.rebase(shift);
+        contact.lastPosition.timestamp += shift;
+        contact.lastValidTouch.timestamp += shift;
+        contact.lastValidTouchTime += shift;
+    }
+    
+    #ifdef WATER_REJECTION_HISTOGRAMS
+    lastSampleTime += shift;
+    #endif
+    lastValidTouchTime += shift;
+    lastValidTouch.timestamp += shift;
+}
+
+// Version, build layout (options, template sizes), payload size, save time
+WRT_TEMPLATE
+void WRT_CLASS::writeStateHeader(uint8_t* header, uint32_t savedAt) const {
+    uint8_t options = 0;
+    #ifdef WATER_REJECTION_COMPACT_ZONES
+    options |= 0x01;
+    #endif
+    #ifdef WATER_REJECTION_MICROS_TIMEBASE
+    options |= 0x02;
+    #endif
+    #ifdef WATER_REJECTION_HISTOGRAMS
+    options |= 0x04;
+    #endif
+    #ifdef WATER_REJECTION_SOA_HISTORY
+    options |= 0x08;
+    #endif
+    
+    header[0] = STATE_SNAPSHOT_VERSION;
+    header[1] = options;
+    header[2] = GridW;
+    header[3] = GridH;
+    header[4] = History;
+    header[5] = MaxPoints;
+    for (uint8_t i = 0; i < 4; i++) {
+        header[6 + i] = (uint8_t)(STATE_PAYLOAD_SIZE >> (8 * i));
+        header[10 + i] = (uint8_t)(savedAt >> (8 * i));
+    }
+}
+
+// CRC-32 (IEEE 802.3), four bits per step from a 16-entry table
+WRT_TEMPLATE
+uint32_t WRT_CLASS::stateChecksum(const uint8_t* data, size_t length) {
+    static const uint32_t table[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4,
+        0x4DB26158, 0x5005713C, 0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+        0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+    };
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+    }
+    return ~crc;
+}
+
+WRT_TEMPLATE
+size_t WRT_CLASS::saveState(uint8_t* buffer, size_t length) const {
+    if (length < STATE_SNAPSHOT_SIZE) {
+        return 0;
+    }
+    
+    writeStateHeader(buffer, waterRejectionNow());
+    StateWriter writer = { buffer + STATE_HEADER_SIZE };
+    transferState(*this, writer);
+    
+    uint32_t crc = stateChecksum(buffer, STATE_HEADER_SIZE + STATE_PAYLOAD_SIZE);
+    for (uint8_t i = 0; i < STATE_CRC_SIZE; i++) {
+        *writer.out++ = (uint8_t)(crc >> (8 * i));
+    }
+    return STATE_SNAPSHOT_SIZE;
+}
+
+WRT_TEMPLATE
+bool WRT_CLASS::restoreState(const uint8_t* buffer, size_t length, uint32_t elapsed) {
+    if (!buffer || length < STATE_SNAPSHOT_SIZE) {
+        return false;
+    }
+    
+    // Everything but the save time must match this build
+    uint8_t expected[STATE_HEADER_SIZE];
+    writeStateHeader(expected, 0);
+    if (memcmp(buffer, expected, STATE_HEADER_SIZE - 4) != 0) {
+        return false;
+    }
+    
+    const uint8_t* stored = buffer + STATE_HEADER_SIZE + STATE_PAYLOAD_SIZE;
+    uint32_t crc = 0;
+    uint32_t savedAt = 0;
+    for (uint8_t i = 0; i < 4; i++) {
+        crc |= (uint32_t)stored[i] << (8 * i);
+        savedAt |= (uint32_t)buffer[10 + i] << (8 * i);
+    }
+    if (crc != stateChecksum(buffer, STATE_HEADER_SIZE + STATE_PAYLOAD_SIZE)) {
+        return false;
+    }
+    
+    StateReader reader = { buffer + STATE_HEADER_SIZE };
+    transferState(*this, reader);
+    
+    // The snapshot was taken elapsed ago on the current clock
+    uint32_t currentTime = waterRejectionNow();
+    rebaseState(currentTime - waterRejectionTicks(elapsed) - savedAt);
+    
+    // Zones that aged out while asleep, and the tuned fields for the level
+    advanceGeneration(currentTime);
+    if (adaptiveWetMode) {
+        applyWetness(wetnessLevel);
+    }
+    return true;
+}
+
+#ifdef WATER_REJECTION_HISTOGRAMS
+WRT_TEMPLATE
+uint8_t WRT_CLASS::log2Bin(uint32_t value, uint8_t binCount) {
+    uint8_t bin = 0;
+    while (value > 0 && bin < binCount - 1) {
+        value >>= 1;
+        bin++;
+    }
+    return bin;
+}
+#endif
+
+#ifdef WATER_REJECTION_PROFILE
+// Profiling
+WRT_TEMPLATE
+WRT_CLASS::StageTimer::StageTimer(WaterRejectionTouchT* filter, ProfileStage timedStage)
+    : owner(filter), stage(timedStage), start(wrtCycleCount()) {
+}
+
+WRT_TEMPLATE
+WRT_CLASS::StageTimer::~StageTimer() {
+    owner->recordStage(stage, wrtCycleCount() - start);
+}
+
+WRT_TEMPLATE
+void WRT_CLASS::recordStage(ProfileStage stage, uint32_t cycles) {
+    StageProfile& profile = stageProfiles[stage];
+    profile.calls++;
+    stageTotals[stage] += cycles;
+    if (cycles < profile.minCycles) {
+        profile.minCycles = cycles;
+    }
+    if (cycles > profile.maxCycles) {
+        profile.maxCycles = cycles;
+    }
+}
+
+WRT_TEMPLATE
+WaterRejectionProfile WRT_CLASS::getProfile() const {
+    WaterRejectionProfile profile;
+    for (uint8_t i = 0; i < PROFILE_STAGE_COUNT; i++) {
+        profile.stages[i] = stageProfiles[i];
+        if (stageProfiles[i].calls > 0) {
+            profile.stages[i].avgCycles = stageTotals[i] / stageProfiles[i].calls;
+        } else {
+            profile.stages[i].minCycles = 0;  // Never ran
+        }
+    }
+    return profile;
+}
+
+WRT_TEMPLATE
+void WRT_CLASS::resetProfile() {
+    for (uint8_t i = 0; i < PROFILE_STAGE_COUNT; i++) {
+        stageProfiles[i].calls = 0;
+        stageProfiles[i].minCycles = 0xFFFFFFFF;
+        stageProfiles[i].avgCycles = 0;
+        stageProfiles[i].maxCycles = 0;
+        stageTotals[i] = 0;
+    }
+}
+#endif
+
+// Calibration presets for the current screen type
+WRT_TEMPLATE
+typename WRT_CLASS::EnvironmentPreset WRT_CLASS::getEnvironmentPreset(bool wetEnvironment) const {
+    EnvironmentPreset preset;
+    if (screenType == SCREEN_RESISTIVE) {
+        if (wetEnvironment) {
+            // Resistive in wet conditions
+            preset.maxTouchArea = 60;
+            preset.maxStaticTime = 400;
+            preset.maxSimultaneousTouches = 1;
+            preset.requireGesture = true;  // Require gesture in wet mode
+            preset.pressureThreshold = 400;  // Higher pressure needed
+            preset.streakWindow = 1500;  // Water runs down the panel
+        } else {
+            // Resistive in normal conditions
+            preset.maxTouchArea = 80;
+            preset.maxStaticTime = 800;
+            preset.maxSimultaneousTouches = 1;
+            preset.requireGesture = false;
+            preset.pressureThreshold = 300;
+        }
+    } else {  // CAPACITIVE
+        if (wetEnvironment) {
+            // Capacitive in wet conditions - very strict
+            preset.maxTouchArea = 30;
+            preset.maxStaticTime = 300;
+            preset.maxSimultaneousTouches = 1;
+            preset.requireGesture = true;
+            preset.streakWindow = 1500;
+        } else {
+            // Capacitive in normal conditions
+            preset.maxTouchArea = 50;
+            preset.maxStaticTime = 500;
+            preset.maxSimultaneousTouches = 2;
+            preset.requireGesture = false;
+        }
+        preset.pressureThreshold = config.pressureThreshold;  // Not used
+    }
+    // Dry keeps the caller's streak window, wet never shortens it
+    if (!wetEnvironment || preset.streakWindow < userStreakWindow) {
+        preset.streakWindow = userStreakWindow;
+    }
+    return preset;
+}
+
+WRT_TEMPLATE
+void WRT_CLASS::applyPreset(const EnvironmentPreset& preset) {
+    config.maxTouchArea = preset.maxTouchArea;
+    config.maxStaticTime = preset.maxStaticTime;
+    config.maxSimultaneousTouches = preset.maxSimultaneousTouches;
+    config.requireGesture = preset.requireGesture;
+    config.pressureThreshold = preset.pressureThreshold;
+    config.streakWindow = preset.streakWindow;
+}
+
+// Calibration
+WRT_TEMPLATE
+void WRT_CLASS::calibrateForEnvironment(bool wetEnvironment) {
+    adaptiveWetMode = false;
+    applyPreset(getEnvironmentPreset(wetEnvironment));
+}
+
+WRT_TEMPLATE
+void WRT_CLASS::setWetModeEnabled(bool enabled) {
+    calibrateForEnvironment(enabled);
+}
+
+// Adaptive wet mode
+WRT_TEMPLATE
+void WRT_CLASS::setAdaptiveWetMode(bool enabled) {
+    if (enabled == adaptiveWetMode) {
+        return;
+    }
+    adaptiveWetMode = enabled;
+    if (enabled) {
+        // Start from dry, and from the dry remaining fields (gesture, pressure)
+        applyPreset(getEnvironmentPreset(false));
+        wetnessEvidence = 0;
+        wetnessLevel = 0;
+        adaptSamples = 0;
+        adaptAreaSum = 0;
+        adaptPatternRejects = getPatternRejects();
+    }
+}
+
+WRT_TEMPLATE
+bool WRT_CLASS::isAdaptiveWetMode() const {
+    return adaptiveWetMode;
+}
+
+WRT_TEMPLATE
+uint8_t WRT_CLASS::getWetnessLevel() const {
+    return wetnessLevel;
+}
+
+// Rejections that do not depend on the tuned fields: how touches spread, and
+// the controller's own verdict. Zone bursts are left out: a finger resting in
+// one zone trips them when dry.
+WRT_TEMPLATE
+uint32_t WRT_CLASS::getPatternRejects() const {
+    return rejectCounts[REJECT_NEIGHBOR_SPREAD] + rejectCounts[REJECT_WIDE_SPREAD] +
+           rejectCounts[REJECT_CLUSTER] + rejectCounts[REJECT_LINE] +
+           rejectCounts[REJECT_HARDWARE];
+}
+
+WRT_TEMPLATE
+void WRT_CLASS::observeTouches(const TouchPoint* touches, uint8_t count) {
+    for (uint8_t i = 0; i < count; i++) {
+        adaptAreaSum += touches[i].area;
+        if (++adaptSamples >= ADAPT_WINDOW) {
+            adaptWetness();
+        }
+    }
+}
+
+// Close a window: map its reject rate and mean area to a level, smooth it,
+// and retune only once the smoothed level has moved past the hysteresis band
+WRT_TEMPLATE
+void WRT_CLASS::adaptWetness() {
+    uint32_t patternRejects = getPatternRejects();
+    uint32_t rejected = patternRejects - adaptPatternRejects;
+    uint32_t rate = rejected >= adaptSamples ? 256 : (rejected << 8) / adaptSamples;
+    uint32_t meanArea = adaptAreaSum / adaptSamples;
+    uint16_t dryArea = getEnvironmentPreset(false).maxTouchArea;
+    
+    uint8_t rateEvidence = ramp(rate, ADAPT_DRY_RATE, ADAPT_WET_RATE);
+    uint8_t areaEvidence = ramp(meanArea, dryArea / 2, dryArea);
+    uint8_t evidence = rateEvidence > areaEvidence ? rateEvidence : areaEvidence;
+    
+    // EWMA with alpha 1/4 per window; truncating division lets it reach both ends
+    wetnessEvidence += (((int32_t)evidence << 8) - wetnessEvidence) / 4;
+    uint8_t target = (wetnessEvidence + 128) >> 8;
+    
+    if (target != wetnessLevel &&
+        (target == 0 || target == 255 ||
+         target >= wetnessLevel + ADAPT_HYSTERESIS || target + ADAPT_HYSTERESIS <= wetnessLevel)) {
+        applyWetness(target);
+    }
+    
+    adaptSamples = 0;
+    adaptAreaSum = 0;
+    adaptPatternRejects = patternRejects;
+}
+
+WRT_TEMPLATE
+void WRT_CLASS::applyWetness(uint8_t level) {
+    EnvironmentPreset dry = getEnvironmentPreset(false);
+    EnvironmentPreset wet = getEnvironmentPreset(true);
+    
+    wetnessLevel = level;
+    config.maxTouchArea = blend(dry.maxTouchArea, wet.maxTouchArea, level);
+    config.maxStaticTime = blend(dry.maxStaticTime, wet.maxStaticTime, level);
+    config.maxSimultaneousTouches = blend(dry.maxSimultaneousTouches, wet.maxSimultaneousTouches, level);
+    config.streakWindow = blend(dry.streakWindow, wet.streakWindow, level);
+}
+
+// 0 below low, 255 from high, linear in between
+WRT_TEMPLATE
+uint8_t WRT_CLASS::ramp(uint32_t value, uint32_t low, uint32_t high) {
+    if (value <= low) {
+        return 0;
+    }
+    if (value >= high) {
+        return 255;
+    }
+    return (value - low) * 255 / (high - low);
+}
+
+// Interpolate a preset field, rounded to nearest
+WRT_TEMPLATE
+uint16_t WRT_CLASS::blend(uint16_t dry, uint16_t wet, uint8_t level) {
+    int32_t delta = ((int32_t)wet - dry) * level;
+    return dry + (delta + (delta < 0 ? -127 : 127)) / 255;
+}
+
+// Touch event detection
+WRT_TEMPLATE
+TouchEvent WRT_CLASS::getTouchEvent(const TouchPoint& current) {
+    return touchEvents.update(current, config.minMovement);
+}
+
+#ifndef WATER_REJECTION_NO_DEBUG
+// Debug methods
+WRT_TEMPLATE
+void WRT_CLASS::printDebugInfo() {
+    Serial.println(F("=== Water Rejection Debug Info ==="));
+    Serial.print(F("Screen Type: "));
+    Serial.println(getScreenTypeName());
+    Serial.print(F("Valid touches: "));
+    Serial.println(validTouches);
+    Serial.print(F("Water droplets rejected: "));
+    Serial.println(waterDropletsRejected);
+    Serial.print(F("Rejection rate: "));
+    if (validTouches + waterDropletsRejected > 0) {
+        float rate = (float)waterDropletsRejected / (validTouches + waterDropletsRejected) * 100;
+        Serial.print(rate);
+        Serial.println(F("%"));
+    } else {
+        Serial.println(F("0%"));
+    }
+    if (adaptiveWetMode) {
+        Serial.print(F("Wetness level: "));
+        Serial.println(wetnessLevel);
+    }
+    Serial.print(F("Gesture state: "));
+    switch (gestureState) {
+        case GESTURE_IDLE: Serial.println(F("IDLE")); break;
+        case GESTURE_WAITING: Serial.println(F("WAITING")); break;
+        case GESTURE_ACTIVE: Serial.println(F("ACTIVE")); break;
+    }
+}
+
+WRT_TEMPLATE
+void WRT_CLASS::printZoneMap() {
+    uint32_t currentTime = waterRejectionNow();
+    advanceGeneration(currentTime);
+    
+    Serial.println(F("=== Zone Activity Map ==="));
+    for (uint8_t y = 0; y < ZONE_GRID_HEIGHT; y++) {
+        for (uint8_t x = 0; x < ZONE_GRID_WIDTH; x++) {
+            uint16_t zoneIndex = zoneIndexOf(x, y);
+            if (isZoneLive(zoneIndex, currentTime)) {
+                Serial.print(getZoneTouchCount(zoneIndex));
+            } else {
+                Serial.print(F("."));
+            }
+            Serial.print(F(" "));
+        }
+        Serial.println();
+    }
+}
+#endif
+
+// Screen type helper methods
+WRT_TEMPLATE
+const char* WRT_CLASS::getScreenTypeName() const {
+    return screenType == SCREEN_RESISTIVE ? "Resistive" : "Capacitive";
+}
+
+WRT_TEMPLATE
+bool WRT_CLASS::isResistiveScreen() const {
+    return screenType == SCREEN_RESISTIVE;
+}
+
+WRT_TEMPLATE
+bool WRT_CLASS::isCapacitiveScreen() const {
+    return screenType == SCREEN_CAPACITIVE;
+}
+
+WRT_TEMPLATE
+void WRT_CLASS::optimizeForScreenType() {
+    // Auto-optimize settings based on screen type
+    if (screenType == SCREEN_RESISTIVE) {
+        #ifndef WATER_REJECTION_NO_DEBUG
+        Serial.println(F("Optimizing water rejection for resistive screen"));
+        #endif
+        // Resistive screens need different handling
+        config.maxTouchArea = 80;
+        config.minMovement = 10;
+        config.maxStaticTime = 800;
+        config.debounceTime = 50;
+        config.pressureThreshold = 300;
+        config.maxSimultaneousTouches = 1;  // Always single touch
+    } else {
+        #ifndef WATER_REJECTION_NO_DEBUG
+        Serial.println(F("Optimizing water rejection for capacitive screen"));
+        #endif
+        // Capacitive screens are more sensitive to water
+        config.maxTouchArea = 50;
+        config.minMovement = 5;
+        config.maxStaticTime = 500;
+        config.debounceTime = 0;  // No debouncing needed
+        config.pressureThreshold = 0;  // Not used
+        config.maxSimultaneousTouches = 2;
+    }
+}
+
+#undef WRT_TEMPLATE
+#undef WRT_CLASS
+#undef WRT_PROFILE_STAGE
+
+#endif // WATER_REJECTION_TOUCH_IMPL_H
\ No newline at end of file
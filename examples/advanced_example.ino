@@ -65,7 +65,9 @@ void setup() {
     waterFilter.begin(config);
     
     // Initialize touch points
-    memset(touchPoints, 0, sizeof(touchPoints));
+    for (uint8_t i = 0; i < 10; i++) {
+        touchPoints[i] = TouchPoint();
+    }
     
     // Draw initial UI
     drawModeButtons();
@@ -80,7 +82,7 @@ void loop() {
     // Handle multi-touch
     uint8_t touches = touch.touched();
     if (touches > 0) {
-        TouchPoint points[5];
+        TouchPoint points[5] = {};
         
         // Read all touch points
         for (uint8_t i = 0; i < touches && i < 5; i++) {
@@ -89,7 +91,7 @@ void loop() {
             // Map coordinates
             points[i].x = map(p.x, 0, 240, 0, 320);
             points[i].y = map(p.y, 0, 320, 0, 240);
-            points[i].timestamp = millis();
+            points[i].timestamp = waterRejectionNow();
             points[i].pressure = p.z;
             points[i].area = p.z / 5;  // Estimate
             points[i].valid = true;
@@ -113,6 +115,9 @@ void loop() {
                 }
             }
         }
+    } else {
+        // Release the lifted contacts
+        waterFilter.processMultiTouch(nullptr, 0);
     }
     
     // Update displays
@@ -0,0 +1,76 @@
+/**
+ * Deep Sleep Warm Boot Example
+ * ESP32 with an FT6x36 panel: the filter state is kept in RTC memory across
+ * deep sleep. The board sleeps soon after the last touch and wakes on the
+ * next one, so the snapshot still holds live zones and any gesture unlock.
+ * The time asleep is counted on restore: zones touched less than
+ * touchTimeout (1 s) before the wake still reject droplets, an unlock keeps
+ * what is left of its time, and the statistics and adaptive wetness level
+ * survive any sleep.
+ */
+
+#define CAPACITIVE_SCREEN
+
+#include <Wire.h>
+#include <sys/time.h>
+#include "WaterRejectionTouch.h"
+#include "TouchControllers.h"
+
+const gpio_num_t TOUCH_INT_PIN = GPIO_NUM_4;
+const uint32_t IDLE_BEFORE_SLEEP = 300;      // ms without a touch, below touchTimeout
+
+FT6x36Touch controller;
+WaterRejectionTouch waterFilter(320, 240);
+TouchPoint points[2];
+uint32_t lastActivity = 0;
+
+// Survives deep sleep, not power loss - restoreState() rejects it then
+RTC_DATA_ATTR uint8_t savedState[WaterRejectionTouch::STATE_SNAPSHOT_SIZE];
+RTC_DATA_ATTR uint64_t sleptAtMs;
+
+// The RTC clock keeps running in deep sleep, millis() does not
+uint64_t rtcMillis() {
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    return (uint64_t)now.tv_sec * 1000 + now.tv_usec / 1000;
+}
+
+void setup() {
+    Serial.begin(115200);
+    Wire.begin();
+    controller.begin();
+
+    waterFilter.begin();
+    if (esp_sleep_get_wakeup_cause() != ESP_SLEEP_WAKEUP_UNDEFINED) {
+        uint32_t asleep = rtcMillis() - sleptAtMs;
+        if (waterFilter.restoreState(savedState, sizeof(savedState), asleep)) {
+            Serial.println("Filter state restored");
+        }
+    }
+    lastActivity = millis();
+}
+
+void loop() {
+    uint8_t count = controller.read(points, 2);
+    if (count != TOUCH_NO_REPORT) {
+        // Count 0 frames release the lifted contacts
+        if (count > 0) {
+            lastActivity = millis();
+        }
+        if (waterFilter.processMultiTouch(points, count)) {
+            Serial.print("Touch: ");
+            Serial.print(points[0].x);
+            Serial.print(", ");
+            Serial.println(points[0].y);
+        }
+    }
+    waterFilter.update();
+
+    if (millis() - lastActivity > IDLE_BEFORE_SLEEP) {
+        waterFilter.saveState(savedState, sizeof(savedState));
+        sleptAtMs = rtcMillis();
+        esp_sleep_enable_ext0_wakeup(TOUCH_INT_PIN, 0);
+        esp_deep_sleep_start();
+    }
+    delay(10);
+}
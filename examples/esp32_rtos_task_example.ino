@@ -0,0 +1,126 @@
+/**
+ * ESP32 RTOS Task Example
+ * Runs water rejection on core 0 while LVGL renders on core 1.
+ * The touch reader task submits raw samples, the filter task processes
+ * them, and the LVGL read callback only copies the latest result.
+ */
+
+#define CAPACITIVE_SCREEN
+
+#include <lvgl.h>
+#include <TFT_eSPI.h>
+#include <Adafruit_FT6206.h>
+#include "WaterRejectionTouch.h"
+#include "WaterRejectionRTOS.h"
+
+static const uint16_t screenWidth = 320;
+static const uint16_t screenHeight = 240;
+static lv_disp_draw_buf_t draw_buf;
+static lv_color_t buf[screenWidth * 10];
+
+TFT_eSPI tft = TFT_eSPI(screenWidth, screenHeight);
+Adafruit_FT6206 touch = Adafruit_FT6206();
+
+WaterRejectionTouch waterFilter(screenWidth, screenHeight);
+WaterRejectionTask filterTask(&waterFilter);
+
+void my_disp_flush(lv_disp_drv_t *disp, const lv_area_t *area, lv_color_t *color_p);
+void my_touchpad_read(lv_indev_drv_t *indev_driver, lv_indev_data_t *data);
+
+// Polls the controller and hands samples to the filter task
+void touchReaderTask(void *param) {
+  bool wasTouched = false;
+
+  for (;;) {
+    if (touch.touched()) {
+      TS_Point p = touch.getPoint();
+      TouchPoint sample = TouchPoint();
+      sample.x = p.x;
+      sample.y = p.y;
+      sample.timestamp = waterRejectionNow();
+      sample.pressure = p.z;
+      sample.area = 10;
+      sample.valid = true;
+      filterTask.submitTouch(sample);
+      wasTouched = true;
+    } else if (wasTouched) {
+      filterTask.submitRelease();
+      wasTouched = false;
+    }
+    vTaskDelay(pdMS_TO_TICKS(10));
+  }
+}
+
+void setup() {
+  Serial.begin(115200);
+
+  tft.begin();
+  tft.setRotation(1);
+  touch.begin(40);
+
+  // Configure the filter before the task takes ownership of it
+  waterFilter.begin();
+
+  WaterRejectionTaskConfig taskConfig;
+  taskConfig.core = 0;        // LVGL and loop() stay on core 1
+  taskConfig.priority = 5;
+  if (!filterTask.start(taskConfig)) {
+    Serial.println("Failed to start water rejection task");
+  }
+
+  xTaskCreatePinnedToCore(touchReaderTask, "TouchReader", 2048, NULL, 4, NULL, 0);
+
+  lv_init();
+  lv_disp_draw_buf_init(&draw_buf, buf, NULL, screenWidth * 10);
+
+  static lv_disp_drv_t disp_drv;
+  lv_disp_drv_init(&disp_drv);
+  disp_drv.hor_res = screenWidth;
+  disp_drv.ver_res = screenHeight;
+  disp_drv.flush_cb = my_disp_flush;
+  disp_drv.draw_buf = &draw_buf;
+  lv_disp_drv_register(&disp_drv);
+
+  static lv_indev_drv_t indev_drv;
+  lv_indev_drv_init(&indev_drv);
+  indev_drv.type = LV_INDEV_TYPE_POINTER;
+  indev_drv.read_cb = my_touchpad_read;
+  lv_indev_drv_register(&indev_drv);
+}
+
+void loop() {
+  lv_timer_handler();
+
+  static unsigned long lastStats = 0;
+  if (millis() - lastStats > 10000) {
+    WaterRejectionTaskStats stats = filterTask.getStats();
+    Serial.printf("Frames: %u dropped: %u queue peak: %u time: %u/%u/%u us\n",
+                  stats.framesProcessed, stats.framesDropped, stats.queueHighWater,
+                  stats.minProcessMicros, stats.avgProcessMicros, stats.maxProcessMicros);
+    lastStats = millis();
+  }
+
+  delay(5);
+}
+
+void my_disp_flush(lv_disp_drv_t *disp, const lv_area_t *area, lv_color_t *color_p) {
+  uint32_t w = (area->x2 - area->x1 + 1);
+  uint32_t h = (area->y2 - area->y1 + 1);
+
+  tft.startWrite();
+  tft.setAddrWindow(area->x1, area->y1, w, h);
+  tft.pushColors((uint16_t *)&color_p->full, w * h, true);
+  tft.endWrite();
+
+  lv_disp_flush_ready(disp);
+}
+
+// Never blocks: copies whatever the filter task published last
+void my_touchpad_read(lv_indev_drv_t *indev_driver, lv_indev_data_t *data) {
+  static WaterRejectionResult latest;
+  filterTask.getLatest(latest);  // Keeps the previous result if the task was mid-publish
+
+  data->state = latest.pressed ? LV_INDEV_STATE_PR : LV_INDEV_STATE_REL;
+  data->point.x = latest.point.x;
+  data->point.y = latest.point.y;
+}
@@ -0,0 +1,60 @@
+/**
+ * Hardware Controller Example
+ * Reads a GT911 with the TouchControllers.h driver: one burst read per
+ * report gives every contact's real size, and the chip's large-area detect
+ * rejects water before the software checks run.
+ */
+
+#define CAPACITIVE_SCREEN
+
+#include <Wire.h>
+#include "WaterRejectionTouch.h"
+#include "TouchControllers.h"
+
+const uint8_t TOUCH_INT_PIN = 4;
+
+GT911Touch controller;
+WaterRejectionTouch waterFilter(480, 320);
+TouchPoint points[5];
+
+void setup() {
+    Serial.begin(115200);
+    Wire.begin();
+    Wire.setClock(400000);
+    pinMode(TOUCH_INT_PIN, INPUT);
+
+    if (!controller.begin(Wire, GT911Touch::DEFAULT_ADDRESS)) {
+        Serial.println("GT911 not found");
+    }
+
+    // GT911 sizes run larger than the estimated default areas
+    WaterRejectionConfig config;
+    config.maxTouchArea = 80;
+    waterFilter.begin(config);
+}
+
+void loop() {
+    // Only touch the bus when the chip signals a new report
+    if (digitalRead(TOUCH_INT_PIN) == LOW) {
+        uint8_t count = controller.read(points, 5);
+        if (count != TOUCH_NO_REPORT && waterFilter.processMultiTouch(points, count) && count > 0) {
+            Serial.print("Touch: ");
+            Serial.print(points[0].x);
+            Serial.print(", ");
+            Serial.print(points[0].y);
+            Serial.print("  area ");
+            Serial.println(points[0].area);
+        }
+    }
+
+    waterFilter.update();
+
+    static uint32_t lastStats = 0;
+    if (millis() - lastStats > 5000) {
+        lastStats = millis();
+        Serial.print("Rejected by the controller: ");
+        Serial.print(waterFilter.getRejectCount(REJECT_HARDWARE));
+        Serial.print("  bus errors: ");
+        Serial.println(controller.getBusErrors());
+    }
+}
@@ -15,6 +15,7 @@
 #include <TFT_eSPI.h>
 #include "ui/ui.h"
 #include "WaterRejectionTouch.h"
+#include "WaterRejectionLVGL.h"
 
 #define LV_LVGL_H_INCLUDE_SIMPLE  
 
@@ -24,11 +25,12 @@ static lv_disp_draw_buf_t draw_buf;
 static lv_color_t buf[screenWidth * 10];
 TFT_eSPI tft = TFT_eSPI(screenWidth, screenHeight); /* TFT instance */
 
-// Water filter instance
+// Water filter instance and the LVGL input device that feeds it
 WaterRejectionTouch waterFilter(screenWidth, screenHeight);
+WaterRejectionIndev touchIndev(&waterFilter);
 
 void my_disp_flush(lv_disp_drv_t *disp, const lv_area_t *area, lv_color_t *color_p);
-void my_touchpad_read(lv_indev_drv_t *indev_driver, lv_indev_data_t *data);
+bool my_touchpad_read(TouchPoint &touch);
 
 void setup() {
   Serial.begin(115200); /* prepare for possible serial debug */
@@ -48,12 +50,10 @@ void setup() {
   disp_drv.draw_buf = &draw_buf;
   lv_disp_drv_register(&disp_drv);
 
-  /*Initialize the (dummy) input device driver*/
-  static lv_indev_drv_t indev_drv;
-  lv_indev_drv_init(&indev_drv);
-  indev_drv.type = LV_INDEV_TYPE_POINTER;
-  indev_drv.read_cb = my_touchpad_read;
-  lv_indev_drv_register(&indev_drv);
+  /*Initialize the water filtered input device*/
+  touchIndev.setTouchSource(my_touchpad_read);
+  touchIndev.setPrediction(30);  // Hide LVGL's default 30 ms read period on drags
+  touchIndev.begin();
 
   ui_init();  // Init EEZ-Studio UI
 
@@ -78,9 +78,7 @@ void setup() {
 }
 
 void loop() {
-  // Update water filter - IMPORTANT!
-  waterFilter.update();
-  
+  // The input device runs waterFilter.update() on every read
   lv_timer_handler(); /* let the GUI do its work */
   ui_tick();  // Update EEZ-Studio UI
   
@@ -119,42 +117,24 @@ void my_disp_flush(lv_disp_drv_t *disp, const lv_area_t *area, lv_color_t *color
   lv_disp_flush_ready(disp);
 }
 
-/*Read the touchpad with water rejection filtering*/
-void my_touchpad_read(lv_indev_drv_t *indev_driver, lv_indev_data_t *data) {
+/*Read the touchpad - the input device filters it and reports to LVGL*/
+bool my_touchpad_read(TouchPoint &touch) {
   uint16_t touchX, touchY;
-  bool touched = tft.getTouch(&touchX, &touchY, 600);
-  
-  if (!touched) {
-    data->state = LV_INDEV_STATE_REL;
-  } else {
-    // Process through water rejection filter
-    // The filter automatically handles debouncing for resistive screens
-    if (waterFilter.processTouch(touchX, touchY)) {
-      // Valid touch - pass to LVGL
-      data->state = LV_INDEV_STATE_PR;
-      data->point.x = touchX;
-      data->point.y = touchY;
-      
-      // Optional: Visual feedback for debugging
-      #ifdef DEBUG_TOUCH
-      Serial.print("Valid touch at: ");
-      Serial.print(touchX);
-      Serial.print(", ");
-      Serial.println(touchY);
-      #endif
-    } else {
-      // Touch rejected as potential water droplet
-      data->state = LV_INDEV_STATE_REL;
-      
-      // Optional: Log rejected touches
-      #ifdef DEBUG_TOUCH
-      Serial.print("REJECTED touch at: ");
-      Serial.print(touchX);
-      Serial.print(", ");
-      Serial.println(touchY);
-      #endif
-    }
+  if (!tft.getTouch(&touchX, &touchY, 600)) {
+    return false;
   }
+  
+  // The filter automatically handles debouncing for resistive screens
+  touch.x = touchX;
+  touch.y = touchY;
+  
+  #ifdef DEBUG_TOUCH
+  Serial.print("Touch at: ");
+  Serial.print(touchX);
+  Serial.print(", ");
+  Serial.println(touchY);
+  #endif
+  return true;
 }
 
 // Optional: Add these functions to control water filtering at runtime
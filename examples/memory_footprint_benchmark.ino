@@ -0,0 +1,81 @@
+/**
+ * Memory Footprint Benchmark
+ * Reports the RAM used by one filter instance and times the hot calls.
+ * Build once as-is and once with WATER_REJECTION_COMPACT_ZONES enabled
+ * to compare the two zone layouts on your board. Enable
+ * WATER_REJECTION_PROFILE to also print a per-stage breakdown.
+ *
+ * Both are library-wide options: uncomment them in the library's
+ * WaterRejectionOptions.h or pass them as global build flags. A #define
+ * here would not reach the library's own sources.
+ */
+
+#include "WaterRejectionTouch.h"
+
+const uint16_t SCREEN_WIDTH = 320;
+const uint16_t SCREEN_HEIGHT = 240;
+const uint16_t ITERATIONS = 1000;
+
+WaterRejectionTouch waterFilter(SCREEN_WIDTH, SCREEN_HEIGHT);
+
+void setup() {
+    Serial.begin(115200);
+    while (!Serial && millis() < 3000);
+
+    waterFilter.begin();
+
+    Serial.println("=== Water Rejection Memory Benchmark ===");
+    #ifdef WATER_REJECTION_COMPACT_ZONES
+    Serial.println("Zone layout: compact");
+    #else
+    Serial.println("Zone layout: plain");
+    #endif
+    Serial.print("sizeof(WaterRejectionTouch): ");
+    Serial.print(sizeof(WaterRejectionTouch));
+    Serial.println(" bytes");
+    Serial.print("sizeof(TouchPoint): ");
+    Serial.print(sizeof(TouchPoint));
+    Serial.println(" bytes");
+
+    // Swipe across the screen so zones and history are populated
+    unsigned long start = micros();
+    for (uint16_t i = 0; i < ITERATIONS; i++) {
+        waterFilter.processTouch((i * 7) % SCREEN_WIDTH, (i * 3) % SCREEN_HEIGHT);
+    }
+    unsigned long touchTime = micros() - start;
+
+    start = micros();
+    for (uint16_t i = 0; i < ITERATIONS; i++) {
+        waterFilter.update();
+    }
+    unsigned long updateTime = micros() - start;
+
+    Serial.print("processTouch(): ");
+    Serial.print((float)touchTime / ITERATIONS, 2);
+    Serial.println(" us/call");
+    Serial.print("update(): ");
+    Serial.print((float)updateTime / ITERATIONS, 2);
+    Serial.println(" us/call");
+
+    #ifdef WATER_REJECTION_PROFILE
+    const char* stageNames[PROFILE_STAGE_COUNT] = {
+        "debounce", "gesture", "water", "static", "streak", "update"
+    };
+    WaterRejectionProfile profile = waterFilter.getProfile();
+    Serial.println("Stage      calls    min    avg    max (cycles)");
+    for (uint8_t i = 0; i < PROFILE_STAGE_COUNT; i++) {
+        Serial.print(stageNames[i]);
+        Serial.print("\t");
+        Serial.print(profile.stages[i].calls);
+        Serial.print("\t");
+        Serial.print(profile.stages[i].minCycles);
+        Serial.print("\t");
+        Serial.print(profile.stages[i].avgCycles);
+        Serial.print("\t");
+        Serial.println(profile.stages[i].maxCycles);
+    }
+    #endif
+}
+
+void loop() {
+}
@@ -0,0 +1,72 @@
+/**
+ * Multi-Panel Bank Example
+ * Two capacitive panels on separate I2C buses of one ESP32, filtered by a
+ * WaterRejectionBank: one shared wet-weather preset, one update() per loop.
+ */
+
+#define CAPACITIVE_SCREEN
+
+#include <Wire.h>
+#include <Adafruit_FT6206.h>
+#include "WaterRejectionTouch.h"
+#include "WaterRejectionBank.h"
+
+const uint8_t PANEL_COUNT = 2;
+const uint16_t SCREEN_WIDTH = 320;
+const uint16_t SCREEN_HEIGHT = 240;
+
+Adafruit_FT6206 controllers[PANEL_COUNT];
+WaterRejectionTouch filters[PANEL_COUNT] = {
+    WaterRejectionTouch(SCREEN_WIDTH, SCREEN_HEIGHT),
+    WaterRejectionTouch(SCREEN_WIDTH, SCREEN_HEIGHT)
+};
+WaterRejectionBankT<WaterRejectionTouch, PANEL_COUNT> bank;
+
+// Copied into each panel by bank.begin(); use bank.setPreset() after a change
+WaterRejectionConfig outdoorPreset;
+
+void setup() {
+    Serial.begin(115200);
+    Wire.begin(21, 22);
+    Wire1.begin(25, 26);
+    controllers[0].begin(40, &Wire);
+    controllers[1].begin(40, &Wire1);
+
+    outdoorPreset.maxTouchArea = 35;
+    outdoorPreset.maxStaticTime = 350;
+    outdoorPreset.streakWindow = 1500;
+
+    for (uint8_t i = 0; i < PANEL_COUNT; i++) {
+        bank.attach(i, &filters[i]);
+    }
+    bank.begin(&outdoorPreset);
+}
+
+void loop() {
+    for (uint8_t i = 0; i < PANEL_COUNT; i++) {
+        if (!controllers[i].touched()) {
+            continue;
+        }
+        TS_Point p = controllers[i].getPoint();
+        TouchPoint sample = TouchPoint();
+        sample.x = p.x;
+        sample.y = p.y;
+        sample.timestamp = waterRejectionNow();
+        sample.pressure = p.z;
+        sample.area = 10;
+        sample.valid = true;
+
+        if (bank.processTouch(i, sample)) {
+            Serial.print("Panel ");
+            Serial.print(i);
+            Serial.print(": ");
+            Serial.print(sample.x);
+            Serial.print(", ");
+            Serial.println(sample.y);
+        }
+    }
+
+    // One call for every panel; returns at once while none is due
+    bank.update();
+    delay(10);
+}
@@ -48,6 +48,8 @@ void setup() {
     
     // Optional: Enable wet mode for outdoor use
     // waterFilter.setWetModeEnabled(true);
+    // Or let the filter tighten and relax itself as conditions change
+    // waterFilter.setAdaptiveWetMode(true);
     
     // Your UI setup here...
     drawYourUI();
@@ -0,0 +1,69 @@
+/**
+ * Trace Recorder Example
+ * Records raw touches and filter verdicts on an ESP32 and flushes them to
+ * LittleFS in whole blocks while the screen is idle. Copy /touch_trace.bin
+ * off the board and replay it with extras/host/replay_harness.
+ */
+
+#define CAPACITIVE_SCREEN
+
+#include <LittleFS.h>
+#include <Adafruit_FT6206.h>
+#include "WaterRejectionTouch.h"
+#include "TouchTraceRecorder.h"
+
+const uint16_t SCREEN_WIDTH = 320;
+const uint16_t SCREEN_HEIGHT = 240;
+const size_t TRACE_BUFFER_SIZE = 64 * TouchTraceRecorder::BLOCK_SIZE;   // 16 KB
+const unsigned long IDLE_FLUSH_MS = 500;
+
+Adafruit_FT6206 touch = Adafruit_FT6206();
+WaterRejectionTouch waterFilter(SCREEN_WIDTH, SCREEN_HEIGHT);
+TouchTraceRecorder recorder;
+File traceFile;
+
+unsigned long lastTouchTime = 0;
+
+void setup() {
+    Serial.begin(115200);
+    touch.begin(40);
+    waterFilter.begin();
+
+    if (!LittleFS.begin(true)) {
+        Serial.println("LittleFS mount failed");
+    }
+    traceFile = LittleFS.open("/touch_trace.bin", FILE_APPEND);
+
+    // Use PSRAM for the ring when the board has it
+    uint8_t* buffer = psramFound() ? (uint8_t*)ps_malloc(TRACE_BUFFER_SIZE)
+                                   : (uint8_t*)malloc(TRACE_BUFFER_SIZE);
+    if (!recorder.begin(buffer, TRACE_BUFFER_SIZE, SCREEN_WIDTH, SCREEN_HEIGHT)) {
+        Serial.println("Trace buffer allocation failed");
+    }
+}
+
+void loop() {
+    if (touch.touched()) {
+        TS_Point p = touch.getPoint();
+        TouchPoint sample = TouchPoint();
+        sample.x = p.x;
+        sample.y = p.y;
+        sample.timestamp = waterRejectionNow();
+        sample.pressure = p.z;
+        sample.area = 10;
+        sample.valid = true;
+
+        bool accepted = waterFilter.processTouch(sample);
+        recorder.record(sample, accepted);   // A few microseconds, no I/O
+        lastTouchTime = millis();
+    } else if (traceFile && millis() - lastTouchTime > IDLE_FLUSH_MS) {
+        // Idle: close the partial block and write everything out
+        recorder.finishBlock();
+        if (recorder.flush(traceFile) > 0) {
+            traceFile.flush();
+        }
+    }
+
+    waterFilter.update();
+    delay(10);
+}
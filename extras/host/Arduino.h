@@ -0,0 +1,104 @@
+/**
+ * Arduino.h (host shim)
+ * Just enough of the Arduino core to build the library natively with g++/clang
+ * for benchmarks and trace replay. Time is virtual: millis()/micros() return
+ * whatever the harness last set with hostSetMillis()/hostSetMicros().
+ *
+ * Author: Assistant
+ * License: MIT
+ */
+
+#ifndef WATER_REJECTION_HOST_ARDUINO_H
+#define WATER_REJECTION_HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdio.h>
+
+#define F(text) (text)
+#define DEC 10
+#define HEX 16
+
+// Virtual clock in microseconds, one per thread so traces can replay in parallel
+inline uint64_t& hostClockMicros() {
+    static thread_local uint64_t clock = 0;
+    return clock;
+}
+
+inline void hostSetMillis(uint32_t ms) { hostClockMicros() = (uint64_t)ms * 1000; }
+inline void hostAdvanceMillis(uint32_t ms) { hostClockMicros() += (uint64_t)ms * 1000; }
+inline void hostSetMicros(uint64_t us) { hostClockMicros() = us; }
+
+inline uint32_t millis() { return (uint32_t)(hostClockMicros() / 1000); }
+inline uint32_t micros() { return (uint32_t)hostClockMicros(); }
+inline void delay(uint32_t ms) { hostAdvanceMillis(ms); }
+inline void delayMicroseconds(uint32_t us) { hostClockMicros() += us; }
+
+// Minimal Print - writes go to a FILE (stdout by default, NULL to mute)
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size) {
+        size_t n = 0;
+        while (n < size && write(buffer[n])) {
+            n++;
+        }
+        return n;
+    }
+
+    size_t print(const char* text) { return write((const uint8_t*)text, strlen(text)); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(long value, int base = DEC) { return printFormatted(base == HEX ? "%lx" : "%ld", value); }
+    size_t print(unsigned long value, int base = DEC) { return printFormatted(base == HEX ? "%lx" : "%lu", value); }
+    size_t print(int value, int base = DEC) { return print((long)value, base); }
+    size_t print(unsigned int value, int base = DEC) { return print((unsigned long)value, base); }
+    size_t print(double value, int digits = 2) {
+        char buffer[48];
+        snprintf(buffer, sizeof(buffer), "%.*f", digits, value);
+        return print(buffer);
+    }
+
+    size_t println() { return print("\n"); }
+    template <typename T>
+    size_t println(T value) { size_t n = print(value); return n + println(); }
+    template <typename T>
+    size_t println(T value, int format) { size_t n = print(value, format); return n + println(); }
+
+private:
+    template <typename T>
+    size_t printFormatted(const char* format, T value) {
+        char buffer[24];
+        snprintf(buffer, sizeof(buffer), format, value);
+        return print(buffer);
+    }
+};
+
+class HostSerial : public Print {
+private:
+    FILE* out;
+
+public:
+    HostSerial() : out(stdout) {}
+
+    void begin(unsigned long) {}
+    void setOutput(FILE* file) { out = file; }
+    int availableForWrite() { return 4096; }
+    operator bool() const { return true; }
+
+    using Print::write;
+    size_t write(uint8_t c) {
+        if (out) {
+            fputc(c, out);
+        }
+        return 1;
+    }
+};
+
+// One stateless instance per translation unit is enough on the host
+static HostSerial Serial;
+
+#endif // WATER_REJECTION_HOST_ARDUINO_H
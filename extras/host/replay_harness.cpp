@@ -0,0 +1,334 @@
+/**
+ * replay_harness.cpp
+ * Native benchmark and accuracy check for the water rejection filter.
+ * Replays labelled touch traces through WaterRejectionTouch and
+ * TouchEventHandler and reports time per call, state size and the
+ * accept/reject confusion matrix.
+ *
+ * Build from the repository root (add -D options to test a build variant,
+ * e.g. -DWATER_REJECTION_FIXED_POINT):
+ *   g++ -std=gnu++11 -O2 -I extras/host -I . extras/host/replay_harness.cpp \
+ *       WaterRejectionTouch.cpp -o replay_harness
+ *
+ * Usage:
+ *   replay_harness [--reps N] [--dump DIR] [trace ...]
+ * Traces are CSV files or TouchTraceRecorder dumps. Without trace files
+ * the four synthetic scenarios are replayed. --dump writes the traces as
+ * CSV so they can be edited or replayed on other builds.
+ *
+ * Author: Assistant
+ * License: MIT
+ */
+
+#include <Arduino.h>
+#include "WaterRejectionTouch.h"
+#include "touch_trace.h"
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct ConfusionMatrix {
+    uint32_t fingerAccepted;             // True positive
+    uint32_t fingerRejected;             // False negative
+    uint32_t waterAccepted;              // False positive
+    uint32_t waterRejected;              // True negative
+
+    void add(bool finger, bool accepted) {
+        if (finger) {
+            accepted ? fingerAccepted++ : fingerRejected++;
+        } else {
+            accepted ? waterAccepted++ : waterRejected++;
+        }
+    }
+};
+
+struct ReplayResult {
+    ConfusionMatrix samples;             // Every contact through processTouch()
+    ConfusionMatrix frames;              // Whole frames through processMultiTouch()
+    ConfusionMatrix scored;              // Every contact through classifyTouch()
+    uint32_t fingerScores[8];            // classifyTouch() scores in bins of 32
+    uint32_t waterScores[8];
+    WaterRejectionStats stats;           // Filter counters after the sample pass
+    double sampleNs;                     // Best rep, per processTouch() call
+    double frameNs;                      // Best rep, per frame
+    double handlerNs;                    // Best rep, per handleTouch() call
+    uint32_t handlerEvents[3];           // Start, move, end callbacks
+};
+
+uint32_t handlerEventCounts[3];
+
+void onStart(int16_t, int16_t) { handlerEventCounts[0]++; }
+void onMove(int16_t, int16_t) { handlerEventCounts[1]++; }
+void onEnd(int16_t, int16_t) { handlerEventCounts[2]++; }
+
+// Trace timestamps start at 0; the filter treats time 0 as "never"
+const uint32_t TIME_OFFSET = 10000;
+
+// Filter time for a trace time (ms), in the build's timebase
+uint32_t traceTicks(uint32_t time) {
+    return (time + TIME_OFFSET) * WATER_REJECTION_TICKS_PER_MS;
+}
+
+// Put the virtual clock at a filter time
+void setClockTicks(uint32_t ticks) {
+    hostSetMicros((uint64_t)ticks * 1000 / WATER_REJECTION_TICKS_PER_MS);
+}
+
+TouchPoint toTouchPoint(const TraceSample& sample) {
+    TouchPoint touch = TouchPoint();
+    touch.x = sample.x;
+    touch.y = sample.y;
+    touch.timestamp = traceTicks(sample.time);
+    touch.pressure = sample.pressure;
+    touch.area = sample.area;
+    touch.valid = true;
+    return touch;
+}
+
+double elapsedNs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+ReplayResult replay(const TouchTrace& trace, uint16_t reps) {
+    ReplayResult result;
+    memset(&result, 0, sizeof(result));
+    result.sampleNs = result.frameNs = result.handlerNs = 1e300;
+
+    const std::vector<TraceSample>& samples = trace.samples;
+    std::vector<TouchPoint> points(samples.size());
+    for (size_t i = 0; i < samples.size(); i++) {
+        points[i] = toTouchPoint(samples[i]);
+    }
+
+    for (uint16_t rep = 0; rep < reps; rep++) {
+        bool record = rep == 0;
+        size_t frameCount = 0;
+
+        // Pass 1: every contact individually, as single-touch integrations do
+        {
+            WaterRejectionTouch filter(trace.screenWidth, trace.screenHeight);
+            setClockTicks(traceTicks(0));
+            filter.begin();
+
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < points.size(); i++) {
+                setClockTicks(points[i].timestamp);
+                bool accepted = filter.processTouch(points[i]);
+                if (record) {
+                    result.samples.add(samples[i].finger, accepted);
+                }
+                if (i + 1 == points.size() || points[i + 1].timestamp != points[i].timestamp) {
+                    filter.update();
+                }
+            }
+            double ns = elapsedNs(start) / (points.empty() ? 1 : points.size());
+            if (ns < result.sampleNs) {
+                result.sampleNs = ns;
+            }
+            if (record) {
+                result.stats = filter.getStatsSnapshot();
+            }
+        }
+
+        // Pass 2: whole frames; a frame is a finger frame if any contact is a finger
+        {
+            WaterRejectionTouch filter(trace.screenWidth, trace.screenHeight);
+            setClockTicks(traceTicks(0));
+            filter.begin();
+
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            for (size_t begin = 0; begin < points.size(); ) {
+                size_t end = traceFrameEnd(trace, begin);
+                setClockTicks(points[begin].timestamp);
+
+                bool accepted = end - begin == 1
+                    ? filter.processTouch(points[begin])
+                    : filter.processMultiTouch(&points[begin], end - begin);
+                filter.update();
+
+                if (record) {
+                    bool finger = false;
+                    for (size_t i = begin; i < end; i++) {
+                        finger |= samples[i].finger;
+                    }
+                    result.frames.add(finger, accepted);
+                }
+                frameCount++;
+                begin = end;
+            }
+            double ns = elapsedNs(start) / (frameCount ? frameCount : 1);
+            if (ns < result.frameNs) {
+                result.frameNs = ns;
+            }
+        }
+
+        // Pass 3: every contact scored, accepted below the default threshold
+        if (record) {
+            WaterRejectionTouch filter(trace.screenWidth, trace.screenHeight);
+            setClockTicks(traceTicks(0));
+            filter.begin();
+            uint8_t threshold = filter.getConfig().scoreThreshold;
+
+            for (size_t i = 0; i < points.size(); i++) {
+                setClockTicks(points[i].timestamp);
+                uint8_t score = filter.classifyTouch(points[i]);
+                result.scored.add(samples[i].finger, score < threshold);
+                (samples[i].finger ? result.fingerScores : result.waterScores)[score / 32]++;
+                if (i + 1 == points.size() || points[i + 1].timestamp != points[i].timestamp) {
+                    filter.update();
+                }
+            }
+        }
+
+        // Pass 4: the callback helper, fed the first contact of each frame
+        {
+            WaterRejectionTouch filter(trace.screenWidth, trace.screenHeight);
+            TouchEventHandler handler(&filter);
+            handler.setTouchStartCallback(onStart);
+            handler.setTouchMoveCallback(onMove);
+            handler.setTouchEndCallback(onEnd);
+            memset(handlerEventCounts, 0, sizeof(handlerEventCounts));
+            setClockTicks(traceTicks(0));
+            filter.begin();
+
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            for (size_t begin = 0; begin < points.size(); begin = traceFrameEnd(trace, begin)) {
+                setClockTicks(points[begin].timestamp);
+                handler.handleTouch(points[begin].x, points[begin].y);
+                handler.update();
+            }
+            double ns = elapsedNs(start) / (frameCount ? frameCount : 1);
+            if (ns < result.handlerNs) {
+                result.handlerNs = ns;
+            }
+            if (record) {
+                memcpy(result.handlerEvents, handlerEventCounts, sizeof(handlerEventCounts));
+            }
+        }
+    }
+
+    return result;
+}
+
+const char* const REASON_NAMES[REJECT_REASON_COUNT] = {
+    "none", "bounds", "pressure", "debounce", "gesture", "area", "zone_burst",
+    "neighbor_spread", "static", "touch_count", "cluster", "line", "streak",
+    "wide_spread", "hardware"
+};
+
+double percent(uint32_t part, uint32_t whole) {
+    return whole ? 100.0 * part / whole : 0.0;
+}
+
+void printMatrix(const char* label, const ConfusionMatrix& m) {
+    uint32_t fingers = m.fingerAccepted + m.fingerRejected;
+    uint32_t water = m.waterAccepted + m.waterRejected;
+    printf("  %-8s          accepted  rejected\n", label);
+    printf("    finger  %10u %9u   (%.1f%% kept)\n", m.fingerAccepted, m.fingerRejected,
+           percent(m.fingerAccepted, fingers));
+    printf("    water   %10u %9u   (%.1f%% rejected)\n", m.waterAccepted, m.waterRejected,
+           percent(m.waterRejected, water));
+}
+
+void printResult(const TouchTrace& trace, const ReplayResult& r) {
+    printf("== %s (%u samples, %ux%u)\n", trace.name.c_str(), (unsigned)trace.samples.size(),
+           trace.screenWidth, trace.screenHeight);
+    printf("  processTouch %.1f ns/call, frame %.1f ns, handler %.1f ns\n",
+           r.sampleNs, r.frameNs, r.handlerNs);
+    printMatrix("samples", r.samples);
+    printMatrix("frames", r.frames);
+    printMatrix("scored", r.scored);
+    printf("  score bins (32 wide)  finger:");
+    for (uint8_t i = 0; i < 8; i++) {
+        printf(" %u", r.fingerScores[i]);
+    }
+    printf("  water:");
+    for (uint8_t i = 0; i < 8; i++) {
+        printf(" %u", r.waterScores[i]);
+    }
+    printf("\n");
+
+    printf("  reject reasons:");
+    for (uint8_t i = REJECT_BOUNDS; i < REJECT_REASON_COUNT; i++) {
+        if (r.stats.rejectCounts[i]) {
+            printf(" %s=%u", REASON_NAMES[i], r.stats.rejectCounts[i]);
+        }
+    }
+    printf("\n  handler events: start=%u move=%u end=%u\n",
+           r.handlerEvents[0], r.handlerEvents[1], r.handlerEvents[2]);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    uint16_t reps = 20;
+    const char* dumpDir = NULL;
+    std::vector<TouchTrace> traces;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--reps" && i + 1 < argc) {
+            reps = atoi(argv[++i]);
+            if (reps == 0) {
+                reps = 1;
+            }
+        } else if (arg == "--dump" && i + 1 < argc) {
+            dumpDir = argv[++i];
+        } else {
+            TouchTrace trace;
+            if (!loadTrace(argv[i], trace)) {
+                fprintf(stderr, "cannot read %s\n", argv[i]);
+                return 1;
+            }
+            traces.push_back(trace);
+        }
+    }
+
+    if (traces.empty()) {
+        TraceGenerator generator(320, 240);
+        traces.push_back(generator.dryFinger());
+        traces.push_back(generator.rain());
+        traces.push_back(generator.streamingWater());
+        traces.push_back(generator.dropletPlusFinger());
+    }
+
+    if (dumpDir) {
+        for (size_t i = 0; i < traces.size(); i++) {
+            std::string path = std::string(dumpDir) + "/" + traces[i].name + ".csv";
+            if (!saveTraceCsv(path.c_str(), traces[i])) {
+                fprintf(stderr, "cannot write %s\n", path.c_str());
+                return 1;
+            }
+        }
+    }
+
+    printf("sizeof(WaterRejectionTouch) = %u bytes\n", (unsigned)sizeof(WaterRejectionTouch));
+    printf("sizeof(TouchEventHandler)   = %u bytes\n", (unsigned)sizeof(TouchEventHandler));
+    printf("sizeof(TouchPoint)          = %u bytes\n", (unsigned)sizeof(TouchPoint));
+
+    ConfusionMatrix total;
+    ConfusionMatrix scoredTotal;
+    memset(&total, 0, sizeof(total));
+    memset(&scoredTotal, 0, sizeof(scoredTotal));
+    for (size_t i = 0; i < traces.size(); i++) {
+        ReplayResult result = replay(traces[i], reps);
+        printResult(traces[i], result);
+
+        total.fingerAccepted += result.samples.fingerAccepted;
+        total.fingerRejected += result.samples.fingerRejected;
+        total.waterAccepted += result.samples.waterAccepted;
+        total.waterRejected += result.samples.waterRejected;
+        scoredTotal.fingerAccepted += result.scored.fingerAccepted;
+        scoredTotal.fingerRejected += result.scored.fingerRejected;
+        scoredTotal.waterAccepted += result.scored.waterAccepted;
+        scoredTotal.waterRejected += result.scored.waterRejected;
+    }
+
+    printf("== all traces\n");
+    printMatrix("samples", total);
+    printMatrix("scored", scoredTotal);
+    return 0;
+}
@@ -0,0 +1,578 @@
+/**
+ * replay_regression.cpp
+ * Speed and accuracy regression gate for long recorded sessions. Each
+ * trace file is memory-mapped and replayed on its own thread through
+ * processTouch(), processBatch(), processMultiTouch() and
+ * TouchEventHandler. Time is measured over blocks of samples and reported
+ * as the median and p99 ns per sample. The accuracy is checked against
+ * the trace labels.
+ *
+ * Build from the repository root on a POSIX host (add -D options to gate a
+ * build variant, e.g. -DWATER_REJECTION_SOA_HISTORY):
+ *   g++ -std=gnu++11 -O2 -pthread -I extras/host -I . \
+ *       extras/host/replay_regression.cpp WaterRejectionTouch.cpp -o replay_regression
+ *
+ * Usage:
+ *   replay_regression [--jobs N] [--reps N] [--save FILE] [--baseline FILE]
+ *                     [--time-tolerance PCT] [--accuracy-tolerance POINTS] [trace ...]
+ * Traces are CSV files or TouchTraceRecorder dumps. Without trace files
+ * the four synthetic scenarios are replayed. --save writes the results as
+ * a baseline. --baseline compares against one and fails when:
+ *   - a median or p99 is more than PCT percent slower (default 20),
+ *   - a finger-kept or water-rejected rate is more than POINTS lower
+ *     (default 0.5), or
+ *   - a trace in the baseline was not replayed.
+ * processBatch() must always return the same verdicts as processTouch(),
+ * and the synthetic scenarios must always reach fixed accuracy floors in
+ * the samples and batch passes (e.g. rain at least 85% rejected), so an
+ * option build that loses accuracy fails even without a baseline. The
+ * scenarios are capacitive, so RESISTIVE_SCREEN builds skip the floors.
+ * The exit status is 1 when any gate fails.
+ *
+ * Author: Assistant
+ * License: MIT
+ */
+
+#include <Arduino.h>
+#include "WaterRejectionTouch.h"
+#include "touch_trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// Trace timestamps start at 0; the filter treats time 0 as "never"
+const uint32_t TIME_OFFSET = 10000;
+
+// Filter time for a trace time (ms), in the build's timebase
+uint32_t traceTicks(uint32_t time) {
+    return (time + TIME_OFFSET) * WATER_REJECTION_TICKS_PER_MS;
+}
+
+// Put the virtual clock at a filter time
+void setClockTicks(uint32_t ticks) {
+    hostSetMicros((uint64_t)ticks * 1000 / WATER_REJECTION_TICKS_PER_MS);
+}
+
+// Samples per timing block. One clock read per block keeps the timer out of
+// the numbers; each block keeps its fastest rep.
+const size_t BLOCK_SAMPLES = 1024;
+
+enum ReplayPass {
+    PASS_SAMPLES,                        // processTouch() per contact
+    PASS_BATCH,                          // processBatch() per frame
+    PASS_FRAMES,                         // processMultiTouch() per frame
+    PASS_HANDLER,                        // TouchEventHandler, first contact per frame
+    PASS_COUNT
+};
+
+const char* const PASS_NAMES[PASS_COUNT] = { "samples", "batch", "frames", "handler" };
+
+// Lowest accepted accuracy of the synthetic scenarios in the per-contact
+// passes, well below what the default build reaches
+struct AccuracyFloor {
+    const char* trace;
+    double kept;                         // Min % of finger samples accepted
+    double rejected;                     // Min % of water samples rejected
+};
+
+const AccuracyFloor ACCURACY_FLOORS[] = {
+    { "dry_finger",          35.0,  0.0 },
+    { "rain",                 0.0, 85.0 },
+    { "streaming_water",      0.0, 80.0 },
+    { "droplet_plus_finger", 35.0, 85.0 },
+};
+
+struct ConfusionMatrix {
+    uint32_t fingerAccepted;
+    uint32_t fingerRejected;
+    uint32_t waterAccepted;
+    uint32_t waterRejected;
+
+    void add(bool finger, bool accepted) {
+        if (finger) {
+            accepted ? fingerAccepted++ : fingerRejected++;
+        } else {
+            accepted ? waterAccepted++ : waterRejected++;
+        }
+    }
+};
+
+struct PassResult {
+    double medianNs;                     // Per sample (handler: per call)
+    double p99Ns;
+    double kept;                         // % of finger samples accepted
+    double rejected;                     // % of water samples rejected
+    bool hasAccuracy;
+};
+
+struct TraceJob {
+    std::string path;                    // Empty for a synthetic trace
+    TouchTrace trace;                    // Samples are freed once replayed
+    size_t sampleCount;
+    PassResult passes[PASS_COUNT];
+    uint32_t batchMismatches;            // Samples where batch and single verdicts differ
+    bool loaded;
+};
+
+// Per-block ns per sample, keeping the fastest of the reps for each block
+class BlockTimer {
+private:
+    std::vector<double>& blocks;
+    size_t index;
+    size_t pending;
+    std::chrono::steady_clock::time_point start;
+
+public:
+    explicit BlockTimer(std::vector<double>& blocks)
+        : blocks(blocks), index(0), pending(0), start(std::chrono::steady_clock::now()) {}
+
+    void add(size_t samples) {
+        pending += samples;
+        if (pending >= BLOCK_SAMPLES) {
+            flush();
+        }
+    }
+
+    void flush() {
+        if (pending == 0) {
+            return;
+        }
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        double ns = std::chrono::duration<double, std::nano>(now - start).count() / pending;
+        if (index == blocks.size()) {
+            blocks.push_back(ns);
+        } else if (ns < blocks[index]) {
+            blocks[index] = ns;
+        }
+        index++;
+        pending = 0;
+        start = now;
+    }
+};
+
+double percent(uint32_t part, uint32_t whole) {
+    return whole ? 100.0 * part / whole : 0.0;
+}
+
+// Nearest-rank percentile
+double percentile(std::vector<double> values, double rank) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    std::sort(values.begin(), values.end());
+    size_t index = (size_t)(rank * values.size() + 0.999999);
+    return values[index == 0 ? 0 : index - 1];
+}
+
+void finishPass(PassResult& result, const std::vector<double>& blocks,
+                const ConfusionMatrix* matrix) {
+    result.medianNs = percentile(blocks, 0.50);
+    result.p99Ns = percentile(blocks, 0.99);
+    result.hasAccuracy = matrix != NULL;
+    if (matrix) {
+        result.kept = percent(matrix->fingerAccepted,
+                              matrix->fingerAccepted + matrix->fingerRejected);
+        result.rejected = percent(matrix->waterRejected,
+                                  matrix->waterAccepted + matrix->waterRejected);
+    } else {
+        result.kept = result.rejected = 0.0;
+    }
+}
+
+// Map the file and parse it in place - no stdio copies of multi-hour sessions
+bool mapTrace(const char* path, TouchTrace& trace) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        return false;
+    }
+
+    trace.name = path;
+    size_t size = info.st_size;
+    if (size == 0) {
+        close(fd);
+        parseTrace(NULL, 0, trace);
+        return true;
+    }
+
+    void* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+    madvise(data, size, MADV_SEQUENTIAL);
+    parseTrace((const uint8_t*)data, size, trace);
+    munmap(data, size);
+    return true;
+}
+
+void replayTrace(TraceJob& job, uint16_t reps) {
+    const TouchTrace& trace = job.trace;
+    const std::vector<TraceSample>& samples = trace.samples;
+    std::vector<TouchPoint> points(samples.size());
+    for (size_t i = 0; i < samples.size(); i++) {
+        TouchPoint& touch = points[i];
+        touch.x = samples[i].x;
+        touch.y = samples[i].y;
+        touch.timestamp = traceTicks(samples[i].time);
+        touch.pressure = samples[i].pressure;
+        touch.area = samples[i].area;
+        touch.valid = true;
+    }
+
+    job.sampleCount = samples.size();
+    std::vector<uint8_t> verdicts(points.size());
+    std::vector<uint8_t> batchVerdicts(points.size());
+    std::vector<double> blocks[PASS_COUNT];
+    ConfusionMatrix matrices[PASS_FRAMES + 1];
+    memset(matrices, 0, sizeof(matrices));
+
+    for (uint16_t rep = 0; rep < reps; rep++) {
+        bool record = rep == 0;
+
+        {
+            WaterRejectionTouch filter(trace.screenWidth, trace.screenHeight);
+            setClockTicks(traceTicks(0));
+            filter.begin();
+
+            BlockTimer timer(blocks[PASS_SAMPLES]);
+            for (size_t i = 0; i < points.size(); i++) {
+                setClockTicks(points[i].timestamp);
+                verdicts[i] = filter.processTouch(points[i]);
+                if (i + 1 == points.size() || points[i + 1].timestamp != points[i].timestamp) {
+                    filter.update();
+                }
+                timer.add(1);
+            }
+            timer.flush();
+        }
+
+        {
+            WaterRejectionTouch filter(trace.screenWidth, trace.screenHeight);
+            setClockTicks(traceTicks(0));
+            filter.begin();
+
+            BlockTimer timer(blocks[PASS_BATCH]);
+            for (size_t begin = 0; begin < points.size(); ) {
+                size_t end = traceFrameEnd(trace, begin);
+                setClockTicks(points[begin].timestamp);
+                filter.processBatch(&points[begin], end - begin, &batchVerdicts[begin]);
+                filter.update();
+                timer.add(end - begin);
+                begin = end;
+            }
+            timer.flush();
+        }
+
+        // processMultiTouch() writes contact IDs, so it gets its own copy
+        std::vector<TouchPoint> framePoints(points);
+        {
+            WaterRejectionTouch filter(trace.screenWidth, trace.screenHeight);
+            setClockTicks(traceTicks(0));
+            filter.begin();
+
+            BlockTimer timer(blocks[PASS_FRAMES]);
+            for (size_t begin = 0; begin < framePoints.size(); ) {
+                size_t end = traceFrameEnd(trace, begin);
+                setClockTicks(framePoints[begin].timestamp);
+                bool accepted = end - begin == 1
+                    ? filter.processTouch(framePoints[begin])
+                    : filter.processMultiTouch(&framePoints[begin], end - begin);
+                filter.update();
+                timer.add(end - begin);
+
+                if (record) {
+                    bool finger = false;
+                    for (size_t i = begin; i < end; i++) {
+                        finger |= samples[i].finger;
+                    }
+                    matrices[PASS_FRAMES].add(finger, accepted);
+                }
+                begin = end;
+            }
+            timer.flush();
+        }
+
+        {
+            WaterRejectionTouch filter(trace.screenWidth, trace.screenHeight);
+            TouchEventHandler handler(&filter);
+            setClockTicks(traceTicks(0));
+            filter.begin();
+
+            BlockTimer timer(blocks[PASS_HANDLER]);
+            for (size_t begin = 0; begin < points.size(); begin = traceFrameEnd(trace, begin)) {
+                setClockTicks(points[begin].timestamp);
+                handler.handleTouch(points[begin].x, points[begin].y);
+                handler.update();
+                timer.add(1);
+            }
+            timer.flush();
+        }
+
+        if (record) {
+            job.batchMismatches = 0;
+            for (size_t i = 0; i < points.size(); i++) {
+                matrices[PASS_SAMPLES].add(samples[i].finger, verdicts[i]);
+                matrices[PASS_BATCH].add(samples[i].finger, batchVerdicts[i]);
+                job.batchMismatches += verdicts[i] != batchVerdicts[i];
+            }
+        }
+    }
+
+    for (uint8_t pass = 0; pass < PASS_COUNT; pass++) {
+        finishPass(job.passes[pass], blocks[pass], pass == PASS_HANDLER ? NULL : &matrices[pass]);
+    }
+}
+
+// One trace per thread, taken in order from a shared index
+void runJobs(std::vector<TraceJob>& jobs, uint16_t reps, unsigned threads) {
+    std::atomic<size_t> nextJob(0);
+    std::vector<std::thread> workers;
+
+    for (unsigned t = 0; t < threads; t++) {
+        workers.push_back(std::thread([&jobs, &nextJob, reps]() {
+            for (size_t i = nextJob++; i < jobs.size(); i = nextJob++) {
+                TraceJob& job = jobs[i];
+                if (!job.path.empty() && !mapTrace(job.path.c_str(), job.trace)) {
+                    continue;
+                }
+                job.loaded = true;
+                replayTrace(job, reps);
+                job.trace.samples = std::vector<TraceSample>();
+            }
+        }));
+    }
+    for (size_t t = 0; t < workers.size(); t++) {
+        workers[t].join();
+    }
+}
+
+void printJob(const TraceJob& job) {
+    printf("== %s (%u samples, %ux%u)\n", job.trace.name.c_str(), (unsigned)job.sampleCount,
+           job.trace.screenWidth, job.trace.screenHeight);
+    printf("  pass       median ns    p99 ns   finger kept  water rejected\n");
+    for (uint8_t pass = 0; pass < PASS_COUNT; pass++) {
+        const PassResult& r = job.passes[pass];
+        if (r.hasAccuracy) {
+            printf("  %-8s %11.1f %9.1f %12.1f%% %14.1f%%\n", PASS_NAMES[pass], r.medianNs,
+                   r.p99Ns, r.kept, r.rejected);
+        } else {
+            printf("  %-8s %11.1f %9.1f %13s %15s\n", PASS_NAMES[pass], r.medianNs, r.p99Ns,
+                   "-", "-");
+        }
+    }
+}
+
+bool saveBaseline(const char* path, const std::vector<TraceJob>& jobs) {
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        return false;
+    }
+    fprintf(file, "# replay_regression baseline: pass median_ns p99_ns kept_pct rejected_pct trace\n");
+    for (size_t i = 0; i < jobs.size(); i++) {
+        for (uint8_t pass = 0; pass < PASS_COUNT && jobs[i].loaded; pass++) {
+            const PassResult& r = jobs[i].passes[pass];
+            fprintf(file, "%s %.2f %.2f %.3f %.3f %s\n", PASS_NAMES[pass], r.medianNs, r.p99Ns,
+                    r.kept, r.rejected, jobs[i].trace.name.c_str());
+        }
+    }
+    fclose(file);
+    return true;
+}
+
+// Returns the number of synthetic scenario passes below their floor
+#ifndef RESISTIVE_SCREEN
+int checkAccuracyFloors(const TraceJob& job) {
+    int failures = 0;
+    for (size_t f = 0; f < sizeof(ACCURACY_FLOORS) / sizeof(ACCURACY_FLOORS[0]); f++) {
+        const AccuracyFloor& floor = ACCURACY_FLOORS[f];
+        if (!job.path.empty() || job.trace.name != floor.trace) {
+            continue;
+        }
+        const uint8_t gated[] = { PASS_SAMPLES, PASS_BATCH };
+        for (uint8_t i = 0; i < sizeof(gated); i++) {
+            const PassResult& r = job.passes[gated[i]];
+            if (r.kept < floor.kept) {
+                printf("FAIL %s %s: finger kept %.1f%%, floor %.1f%%\n", floor.trace,
+                       PASS_NAMES[gated[i]], r.kept, floor.kept);
+                failures++;
+            }
+            if (r.rejected < floor.rejected) {
+                printf("FAIL %s %s: water rejected %.1f%%, floor %.1f%%\n", floor.trace,
+                       PASS_NAMES[gated[i]], r.rejected, floor.rejected);
+                failures++;
+            }
+        }
+    }
+    return failures;
+}
+#endif
+
+// Returns the number of failed gates, or -1 if the baseline cannot be read
+int compareBaseline(const char* path, const std::vector<TraceJob>& jobs,
+                    double timeTolerance, double accuracyTolerance) {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        return -1;
+    }
+
+    int failures = 0;
+    char line[512];
+    while (fgets(line, sizeof(line), file)) {
+        char passName[16];
+        char name[400];
+        double median, p99, kept, rejected;
+        if (line[0] == '#' || sscanf(line, "%15s %lf %lf %lf %lf %399[^\r\n]", passName, &median,
+                                     &p99, &kept, &rejected, name) != 6) {
+            continue;
+        }
+
+        uint8_t pass = 0;
+        while (pass < PASS_COUNT && strcmp(PASS_NAMES[pass], passName) != 0) {
+            pass++;
+        }
+        const TraceJob* job = NULL;
+        for (size_t i = 0; i < jobs.size() && !job; i++) {
+            if (jobs[i].loaded && jobs[i].trace.name == name) {
+                job = &jobs[i];
+            }
+        }
+        if (pass == PASS_COUNT || !job) {
+            printf("FAIL %s %s: not replayed\n", name, passName);
+            failures++;
+            continue;
+        }
+
+        const PassResult& r = job->passes[pass];
+        double slowest = 1.0 + timeTolerance / 100.0;
+        if (r.medianNs > median * slowest) {
+            printf("FAIL %s %s: median %.1f ns, baseline %.1f ns\n", name, passName,
+                   r.medianNs, median);
+            failures++;
+        }
+        if (r.p99Ns > p99 * slowest) {
+            printf("FAIL %s %s: p99 %.1f ns, baseline %.1f ns\n", name, passName, r.p99Ns, p99);
+            failures++;
+        }
+        if (r.hasAccuracy && r.kept < kept - accuracyTolerance) {
+            printf("FAIL %s %s: finger kept %.1f%%, baseline %.1f%%\n", name, passName,
+                   r.kept, kept);
+            failures++;
+        }
+        if (r.hasAccuracy && r.rejected < rejected - accuracyTolerance) {
+            printf("FAIL %s %s: water rejected %.1f%%, baseline %.1f%%\n", name, passName,
+                   r.rejected, rejected);
+            failures++;
+        }
+    }
+
+    fclose(file);
+    return failures;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    uint16_t reps = 5;
+    unsigned threads = std::thread::hardware_concurrency();
+    const char* savePath = NULL;
+    const char* baselinePath = NULL;
+    double timeTolerance = 20.0;
+    double accuracyTolerance = 0.5;
+    std::vector<TraceJob> jobs;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--reps" && i + 1 < argc) {
+            reps = atoi(argv[++i]);
+        } else if (arg == "--jobs" && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (arg == "--save" && i + 1 < argc) {
+            savePath = argv[++i];
+        } else if (arg == "--baseline" && i + 1 < argc) {
+            baselinePath = argv[++i];
+        } else if (arg == "--time-tolerance" && i + 1 < argc) {
+            timeTolerance = atof(argv[++i]);
+        } else if (arg == "--accuracy-tolerance" && i + 1 < argc) {
+            accuracyTolerance = atof(argv[++i]);
+        } else {
+            TraceJob job = TraceJob();
+            job.path = argv[i];
+            jobs.push_back(job);
+        }
+    }
+    if (reps == 0) {
+        reps = 1;
+    }
+
+    if (jobs.empty()) {
+        TraceGenerator generator(320, 240);
+        TouchTrace traces[4] = { generator.dryFinger(), generator.rain(),
+                                 generator.streamingWater(), generator.dropletPlusFinger() };
+        for (uint8_t i = 0; i < 4; i++) {
+            TraceJob job = TraceJob();
+            job.trace = traces[i];
+            jobs.push_back(job);
+        }
+    }
+
+    if (threads == 0 || threads > jobs.size()) {
+        threads = jobs.size();
+    }
+    runJobs(jobs, reps, threads);
+
+    int failures = 0;
+    for (size_t i = 0; i < jobs.size(); i++) {
+        const TraceJob& job = jobs[i];
+        if (!job.loaded) {
+            fprintf(stderr, "cannot read %s\n", job.path.c_str());
+            failures++;
+            continue;
+        }
+        printJob(job);
+        if (job.batchMismatches) {
+            printf("FAIL %s batch: %u verdicts differ from processTouch()\n",
+                   job.trace.name.c_str(), job.batchMismatches);
+            failures++;
+        }
+        #ifndef RESISTIVE_SCREEN
+        failures += checkAccuracyFloors(job);
+        #endif
+    }
+
+    if (savePath && !saveBaseline(savePath, jobs)) {
+        fprintf(stderr, "cannot write %s\n", savePath);
+        return 1;
+    }
+    if (baselinePath) {
+        int baselineFailures = compareBaseline(baselinePath, jobs, timeTolerance,
+                                               accuracyTolerance);
+        if (baselineFailures < 0) {
+            fprintf(stderr, "cannot read %s\n", baselinePath);
+            return 1;
+        }
+        failures += baselineFailures;
+    }
+
+    if (failures) {
+        printf("%d gate%s failed\n", failures, failures == 1 ? "" : "s");
+        return 1;
+    }
+    printf("all gates passed\n");
+    return 0;
+}
@@ -0,0 +1,390 @@
+/**
+ * touch_trace.h
+ * Labelled touch traces for the host tools: CSV load/save and synthetic
+ * generators for the four reference scenarios.
+ *
+ * CSV format, one contact per line ('#' starts a comment):
+ *   time_ms,x,y,area,pressure,label
+ * label is 1 for an intended finger touch and 0 for water. Consecutive lines
+ * with the same time_ms form one controller frame. An optional first comment
+ * "# name WIDTHxHEIGHT" sets the screen size (320x240 otherwise).
+ *
+ * loadTrace() also reads the binary block files written by
+ * TouchTraceRecorder. Those carry the filter's verdict rather than ground
+ * truth, so label = recorded verdict until the file is relabelled.
+ *
+ * Author: Assistant
+ * License: MIT
+ */
+
+#ifndef WATER_REJECTION_TOUCH_TRACE_H
+#define WATER_REJECTION_TOUCH_TRACE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+struct TraceSample {
+    uint32_t time;
+    int16_t x;
+    int16_t y;
+    uint16_t area;
+    uint8_t pressure;
+    bool finger;                         // Ground truth: true = should be accepted
+};
+
+struct TouchTrace {
+    std::string name;
+    uint16_t screenWidth;
+    uint16_t screenHeight;
+    std::vector<TraceSample> samples;    // Sorted by time
+};
+
+// Index of the first sample after the frame starting at begin
+inline size_t traceFrameEnd(const TouchTrace& trace, size_t begin) {
+    size_t end = begin + 1;
+    while (end < trace.samples.size() && trace.samples[end].time == trace.samples[begin].time) {
+        end++;
+    }
+    return end;
+}
+
+// Parse one CSV line into trace; comments, blank and malformed lines add nothing
+inline void parseTraceCsvLine(const char* line, TouchTrace& trace) {
+    if (line[0] == '#') {
+        unsigned width, height;
+        if (trace.samples.empty() && sscanf(line, "# %*s %ux%u", &width, &height) == 2) {
+            trace.screenWidth = width;
+            trace.screenHeight = height;
+        }
+        return;
+    }
+    if (line[0] == '\n' || line[0] == '\r') {
+        return;
+    }
+    unsigned long time;
+    int x, y, area, pressure, label;
+    if (sscanf(line, "%lu,%d,%d,%d,%d,%d", &time, &x, &y, &area, &pressure, &label) != 6) {
+        return;  // Header or malformed line
+    }
+    TraceSample sample;
+    sample.time = time;
+    sample.x = x;
+    sample.y = y;
+    sample.area = area;
+    sample.pressure = pressure;
+    sample.finger = label != 0;
+    trace.samples.push_back(sample);
+}
+
+inline bool loadTraceCsv(const char* path, TouchTrace& trace) {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        return false;
+    }
+
+    trace.name = path;
+    trace.screenWidth = 320;
+    trace.screenHeight = 240;
+    trace.samples.clear();
+
+    char line[256];
+    while (fgets(line, sizeof(line), file)) {
+        parseTraceCsvLine(line, trace);
+    }
+
+    fclose(file);
+    return true;
+}
+
+// Parse CSV text already in memory (e.g. a mapped file, not NUL-terminated)
+inline void parseTraceCsv(const char* data, size_t size, TouchTrace& trace) {
+    char line[256];
+    size_t pos = 0;
+    while (pos < size) {
+        size_t length = 0;
+        while (pos < size && data[pos] != '\n') {
+            if (length < sizeof(line) - 2) {
+                line[length++] = data[pos];
+            }
+            pos++;
+        }
+        pos++;
+        line[length++] = '\n';
+        line[length] = '\0';
+        parseTraceCsvLine(line, trace);
+    }
+}
+
+// TouchTraceRecorder block format - see TouchTraceRecorder.h
+const uint16_t RECORDER_BLOCK_SIZE = 256;
+const uint8_t RECORDER_HEADER_SIZE = 16;
+const uint8_t RECORDER_BLOCK_MAGIC = 0x57;
+const uint8_t RECORDER_FORMAT_VERSION = 1;
+const uint8_t RECORDER_FLAG_ACCEPTED = 0x01;
+const uint8_t RECORDER_FLAG_VALID = 0x02;
+
+inline bool readVarint(const uint8_t* data, size_t end, size_t& pos, uint32_t& value) {
+    value = 0;
+    for (uint8_t shift = 0; shift < 35 && pos < end; shift += 7) {
+        uint8_t byte = data[pos++];
+        value |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+inline int32_t unzigzag(uint32_t value) {
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+// Decode one recorder block, appending its samples. Returns false if the
+// block is not a valid recorder block (releases are skipped, not errors).
+inline bool decodeRecorderBlock(const uint8_t* block, TouchTrace& trace) {
+    if (block[0] != RECORDER_BLOCK_MAGIC || block[1] != RECORDER_FORMAT_VERSION) {
+        return false;
+    }
+    size_t length = block[2] | block[3] << 8;
+    if (length < RECORDER_HEADER_SIZE || length > RECORDER_BLOCK_SIZE) {
+        return false;
+    }
+
+    uint32_t time = block[8] | block[9] << 8 | block[10] << 16 | (uint32_t)block[11] << 24;
+    trace.screenWidth = block[12] | block[13] << 8;
+    trace.screenHeight = block[14] | block[15] << 8;
+
+    int32_t x = 0, y = 0;
+    size_t pos = RECORDER_HEADER_SIZE;
+    while (pos < length) {
+        uint8_t flags = block[pos++];
+        uint32_t dx, dy, dt, packed;
+        if (!readVarint(block, length, pos, dx) || !readVarint(block, length, pos, dy) ||
+            !readVarint(block, length, pos, dt) || !readVarint(block, length, pos, packed)) {
+            return false;
+        }
+        x += unzigzag(dx);
+        y += unzigzag(dy);
+        time += dt;
+
+        if (!(flags & RECORDER_FLAG_VALID)) {
+            continue;
+        }
+        TraceSample sample;
+        sample.time = time;
+        sample.x = x;
+        sample.y = y;
+        sample.area = packed >> 8;
+        sample.pressure = packed & 0xFF;
+        sample.finger = flags & RECORDER_FLAG_ACCEPTED;
+        trace.samples.push_back(sample);
+    }
+    return true;
+}
+
+inline bool loadTraceRecording(const char* path, TouchTrace& trace) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+
+    trace.name = path;
+    trace.screenWidth = 320;
+    trace.screenHeight = 240;
+    trace.samples.clear();
+
+    // Corrupt blocks are skipped; each block stands alone
+    uint8_t block[RECORDER_BLOCK_SIZE];
+    while (fread(block, 1, sizeof(block), file) == sizeof(block)) {
+        decodeRecorderBlock(block, trace);
+    }
+
+    fclose(file);
+    return true;
+}
+
+// Parse whole recorder blocks already in memory; a partial last block is ignored
+inline void parseTraceRecording(const uint8_t* data, size_t size, TouchTrace& trace) {
+    for (size_t pos = 0; pos + RECORDER_BLOCK_SIZE <= size; pos += RECORDER_BLOCK_SIZE) {
+        decodeRecorderBlock(data + pos, trace);
+    }
+}
+
+// Either format from memory, told apart by the first byte like loadTrace()
+inline void parseTrace(const uint8_t* data, size_t size, TouchTrace& trace) {
+    trace.screenWidth = 320;
+    trace.screenHeight = 240;
+    trace.samples.clear();
+    if (size > 0 && data[0] == RECORDER_BLOCK_MAGIC) {
+        parseTraceRecording(data, size, trace);
+    } else {
+        parseTraceCsv((const char*)data, size, trace);
+    }
+}
+
+// Load either format, telling them apart by the first byte
+inline bool loadTrace(const char* path, TouchTrace& trace) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+    int first = fgetc(file);
+    fclose(file);
+
+    return first == RECORDER_BLOCK_MAGIC ? loadTraceRecording(path, trace)
+                                         : loadTraceCsv(path, trace);
+}
+
+inline bool saveTraceCsv(const char* path, const TouchTrace& trace) {
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        return false;
+    }
+
+    fprintf(file, "# %s %ux%u\n", trace.name.c_str(), trace.screenWidth, trace.screenHeight);
+    fprintf(file, "time_ms,x,y,area,pressure,label\n");
+    for (size_t i = 0; i < trace.samples.size(); i++) {
+        const TraceSample& s = trace.samples[i];
+        fprintf(file, "%lu,%d,%d,%u,%u,%d\n", (unsigned long)s.time, s.x, s.y, s.area,
+                s.pressure, s.finger ? 1 : 0);
+    }
+
+    fclose(file);
+    return true;
+}
+
+// Synthetic traces - deterministic for a given seed
+class TraceGenerator {
+private:
+    uint32_t state;
+    uint16_t width;
+    uint16_t height;
+
+    // Contact alive over [start, end) moving linearly from (x0, y0) to (x1, y1)
+    struct Contact {
+        uint32_t start;
+        uint32_t end;
+        float x0, y0, x1, y1;
+        uint16_t area;
+        bool finger;
+    };
+
+    std::vector<Contact> contacts;
+
+    uint32_t next() {
+        state = state * 1664525u + 1013904223u;
+        return state >> 8;
+    }
+
+    int range(int low, int high) {
+        return low + (int)(next() % (uint32_t)(high - low + 1));
+    }
+
+    void addContact(uint32_t start, uint32_t duration, float x0, float y0, float x1, float y1,
+                    uint16_t area, bool finger) {
+        Contact c = { start, start + duration, x0, y0, x1, y1, area, finger };
+        contacts.push_back(c);
+    }
+
+    void addFingerStrokes(uint32_t start, uint32_t end) {
+        uint32_t t = start;
+        while (t < end) {
+            uint32_t duration = range(80, 600);
+            float x0 = range(20, width - 20);
+            float y0 = range(20, height - 20);
+            bool tap = range(0, 2) == 0;
+            float x1 = tap ? x0 + range(-3, 3) : range(20, width - 20);
+            float y1 = tap ? y0 + range(-3, 3) : range(20, height - 20);
+            addContact(t, duration, x0, y0, x1, y1, range(6, 25), true);
+            t += duration + range(150, 900);
+        }
+    }
+
+    void addDroplets(uint32_t start, uint32_t end, uint32_t meanGap) {
+        uint32_t t = start;
+        while (t < end) {
+            float x = range(0, width - 1);
+            float y = range(0, height - 1);
+            addContact(t, range(100, 1500), x, y, x + range(-2, 2), y + range(-2, 2),
+                       range(10, 90), false);
+            t += range(meanGap / 2, meanGap * 3 / 2);
+        }
+    }
+
+    void addStreams(uint32_t start, uint32_t end) {
+        uint32_t t = start;
+        while (t < end) {
+            // A rivulet of a few beads running down the glass together
+            float x = range(10, width - 10);
+            uint32_t duration = range(800, 3000);
+            float drop = range(height / 3, height);
+            uint8_t beads = range(2, 4);
+            for (uint8_t b = 0; b < beads; b++) {
+                float y = range(0, height / 3) + b * 12;
+                addContact(t + b * 20, duration, x + range(-2, 2), y, x + range(-8, 8),
+                           y + drop, range(20, 60), false);
+            }
+            t += duration / 2 + range(200, 1200);
+        }
+    }
+
+    TouchTrace render(const char* name, uint32_t duration, uint32_t samplePeriod) {
+        TouchTrace trace;
+        trace.name = name;
+        trace.screenWidth = width;
+        trace.screenHeight = height;
+
+        for (uint32_t t = 0; t < duration; t += samplePeriod) {
+            for (size_t i = 0; i < contacts.size(); i++) {
+                const Contact& c = contacts[i];
+                if (t < c.start || t >= c.end) {
+                    continue;
+                }
+                float f = (float)(t - c.start) / (c.end - c.start);
+                TraceSample s;
+                s.time = t;
+                s.x = (int16_t)(c.x0 + (c.x1 - c.x0) * f + range(-1, 1));
+                s.y = (int16_t)(c.y0 + (c.y1 - c.y0) * f + range(-1, 1));
+                s.area = c.area + range(-2, 2);
+                s.pressure = c.finger ? range(120, 220) : range(20, 120);
+                s.finger = c.finger;
+                if (s.x < 0 || s.x >= width || s.y < 0 || s.y >= height) {
+                    continue;  // Ran off the glass - the controller would not report it
+                }
+                trace.samples.push_back(s);
+            }
+        }
+
+        contacts.clear();
+        return trace;
+    }
+
+public:
+    TraceGenerator(uint16_t width, uint16_t height, uint32_t seed = 12345)
+        : state(seed), width(width), height(height) {}
+
+    TouchTrace dryFinger(uint32_t duration = 20000) {
+        addFingerStrokes(0, duration);
+        return render("dry_finger", duration, 10);
+    }
+
+    TouchTrace rain(uint32_t duration = 20000) {
+        addDroplets(0, duration, 120);
+        return render("rain", duration, 10);
+    }
+
+    TouchTrace streamingWater(uint32_t duration = 20000) {
+        addStreams(0, duration);
+        return render("streaming_water", duration, 10);
+    }
+
+    TouchTrace dropletPlusFinger(uint32_t duration = 20000) {
+        addFingerStrokes(0, duration);
+        addDroplets(0, duration, 400);
+        return render("droplet_plus_finger", duration, 10);
+    }
+};
+
+#endif // WATER_REJECTION_TOUCH_TRACE_H